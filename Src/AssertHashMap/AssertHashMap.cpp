@@ -1,8 +1,14 @@
+#include <algorithm>
+#include <iterator>
 #include <set>
+#include <string>
 #include <vector>
+#include "TestTool/ScanCache.hpp"
 #include "TestTool/TestFile.hpp"
+#include "TestTool/ToolArgs.hpp"
 #include "Util/Assert.hpp"
 #include "Util/SystemCout.hpp"
+#include "Util/WorkStealingPool.hpp"
 
 // Find all the C++ source and header files in the given directory
 // and recursively all its subdirectories.
@@ -26,31 +32,40 @@ void findCppFiles(std::vector<FilePath>& cppFileList, DirPath dir) {
 	}
 }
 
+// Count the occurrences in a line of token immediately followed by terminator
+// where the token is not the tail of a longer identifier.
+int countTokens(const String& line, const String& token, Char terminator) {
+	int count = 0;
+	String target = token + terminator;
+	for (StringIterPair pr = line.findFirst(target); !pr.atEnd(); pr = pr.second().findNext(target)) {
+		StringIter it = pr.first();
+		if (!it.atBegin()) {
+			Char prev = *--it;
+			if (prev.isLetter() || (prev == '_')) {
+				continue;
+			}
+		}
+		++count;
+	}
+	return count;
+}
+
 // Find all the assertion lines in a file.
 void findAssertionLines(FilePath fpath, std::vector<int>& lines) {
 	FileEncodedInputPtr fin = FileEncodedInput::open(CharEncoding::DEFAULT, fpath);
-	for (;;) {
-		Char ch = fin->read();
-		if (ch.isEof()) break;
-		if (!ch.isLetter() && (ch != '_')) continue;
-
-		String s;
-		do {
-			s += ch;
-			ch = fin->read();
-		} while (ch.isLetter() || (ch == '_'));
-
-		if (((ch == '(') && (s == "ASSERT")) ||
-			((ch == ';') && (s == "FAIL"))) 
-		{
+	String line;
+	while (fin->readLine(line)) {
+		int count = countTokens(line, "ASSERT", '(') + countTokens(line, "FAIL", ';');
+		for (int i = 0; i < count; i++) {
 			lines.push_back(fin->getLine());
 		}
+		line.clear();
 	}
 }
 
 struct Result {
 	Result(std::uint32_t hash_, String file_, int line_) :
-		hash(hash_), file(file_), line(line_)
+		hash(hash_), file(std::move(file_)), line(line_)
 	{
 	}
 	bool operator<(const Result& other) const {
@@ -83,7 +98,7 @@ public:
 	void writeError(const FilePath& path) { throw String("file write error"); }
 };
 
-void doMain() {
+void doMain(Uint threadCount) {
 	DirPath srcDir = TestFile::getSrcDir("");
 	if (!srcDir.exists()) {
 		throw String("cannot find source directory");
@@ -96,32 +111,81 @@ void doMain() {
 	std::vector<FilePath> cppFileList;
 	findCppFiles(cppFileList, srcDir);
 
-	// Get the results for each file
-	std::set<Result> results;
-
-	for (auto fp : cppFileList) {
+	// Load the results from the last run
+	FilePath cacheFile = TestFile::getTestFile("AssertHashMap/_HashMapCache.bin");
+	ScanCache oldCache = ScanCache::load(cacheFile);
+
+	// Get the results for each file into per-thread results. Unchanged files
+	// are taken from the cache.
+	std::vector<std::vector<Result>> threadResults(threadCount);
+	std::vector<ScanCache> threadCaches(threadCount);
+	std::vector<int> threadHits(threadCount, 0);
+	std::vector<int> threadMisses(threadCount, 0);
+	WorkStealingPool::run((Uint)cppFileList.size(), threadCount, [&](Uint index, Uint thread) {
+		const FilePath& fp = cppFileList[index];
+		String file = fp.str();
+
+		// Strip off the prefix up to and including the Src directory.
+		StringIterPair pr = file.findFirst(basePrefix);
+		ASSERT(pr.first().atBegin());
+		String file2 = pr.second().substrAfter();
+		std::string cacheKey = file2.toUtf8();
+
+		Uint64 size = 0;
+		Int64 modifiedTime = 0;
 		std::vector<int> lines;
-		findAssertionLines(fp, lines);
-		for (auto line : lines) {
-			String file = fp.str();
-
-			// Strip off the prefix up to and including the Src directory.
-			StringIterPair pr = file.findFirst(basePrefix);
-			ASSERT(pr.first().atBegin());
-			String file2 = pr.second().substrAfter();
+		bool hasStatus = fp.getStatus(size, modifiedTime);
+		if (hasStatus && oldCache.find(cacheKey, size, modifiedTime, lines)) {
+			++threadHits[thread];
+		}
+		else {
+			findAssertionLines(fp, lines);
+			++threadMisses[thread];
+		}
 
-			std::uint32_t hash = AssertHash::fileLineHash(file2.toUtf8().c_str(), line);
-			Result r(hash, file2, line);
-			results.insert(r);
+		for (auto line : lines) {
+			std::uint32_t hash = AssertHash::fileLineHash(cacheKey.c_str(), line);
+			threadResults[thread].push_back(Result(hash, file2, line));
+		}
+		if (hasStatus) {
+			threadCaches[thread].set(cacheKey, size, modifiedTime, lines);
+		}
+	});
+
+	// The cache for the next run. Deleted files drop out.
+	ScanCache newCache;
+	int hits = 0;
+	int misses = 0;
+	for (Uint t = 0; t < threadCount; t++) {
+		newCache.merge(threadCaches[t]);
+		hits += threadHits[t];
+		misses += threadMisses[t];
+	}
+	int removed = 0;
+	for (const std::string& key : oldCache.keys()) {
+		if (!newCache.contains(key)) {
+			++removed;
 		}
 	}
 
+	// Merge and sort. The order and duplicate removal are the same as for a
+	// std::set so the output does not depend on the number of threads.
+	std::vector<Result> results;
+	for (auto& tr : threadResults) {
+		results.insert(results.end(), std::make_move_iterator(tr.begin()), std::make_move_iterator(tr.end()));
+	}
+	std::sort(results.begin(), results.end());
+	results.erase(
+		std::unique(results.begin(), results.end(), 
+			[](const Result& a, const Result& b) { return !(a < b) && !(b < a); }),
+		results.end());
+
 	// Output to a string
 	std::uint32_t lastHash = 0;
 	int collisionCount = 0;
 	int count = 0;
 	String str;
-	for (auto r : results) {
+	for (const auto& r : results) {
 		if (r.hash == lastHash) {
 			scout << "Hash collision for hash " << r.hash << sendl;
 			++collisionCount;
@@ -152,27 +216,30 @@ void doMain() {
 		++count;
 	}
 
-	// Output string to a file
+	// Output string to a file. The cache is only saved once this has
+	// succeeded (a write error throws), so a failed run cannot leave a cache
+	// which is trusted by the next run.
 	TestFile::createEncodedTestFile(
 		CharEncoding::DEFAULT, 
 		"AssertHashMap/_HashMap.txt",
 		str);
+	newCache.save(cacheFile);
 
 	scout << collisionCount << " hash collisions" << sendl;
 	scout << count << " assertion errors" << sendl;
+	scout << hits << " cache hits, " << misses << " cache misses, " << removed << " files removed" << sendl;
 }
 
 // A utility program to examine all source files for ASSERT or
 // FAIL macros and then output a map from the file/line hash
 // for this assertion error to the file and line number.
 // The map is output to Test/.../AssertHashMap/_HashMap.txt.
+// Usage: AssertHashMap.exe [-j N]
+// where N is the number of threads to scan files with (default
+// is the hardware concurrency).
 int main(int argc, char** argv) {
 	try {
-		if (argc != 1) {
-			throw String("no arguments expected for AssertHashMap.exe");
-		}
-	
-		doMain();
+		doMain(ToolArgs::threadCountFromArgs(argc, argv, "usage: AssertHashMap.exe [-j N]"));
 	}
 	catch (String& ex) {
 		scout << "Error: " << ex << sendl;
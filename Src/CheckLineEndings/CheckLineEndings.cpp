@@ -1,8 +1,17 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
 #include <set>
+#include <string>
 #include <vector>
 #include "TestTool/TestFile.hpp"
+#include "TestTool/ToolArgs.hpp"
 #include "Util/Assert.hpp"
+#include "Util/Char/Utf8Scan.hpp"
+#include "Util/CharInputConverter.hpp"
 #include "Util/SystemCout.hpp"
+#include "Util/WorkStealingPool.hpp"
 
 // Find all the C++ source and header files in the given directory
 // and recursively all its subdirectories.
@@ -25,44 +34,96 @@ void findCppFiles(std::vector<FilePath>& cppFileList, DirPath dir) {
 		}
 	}
 }
-// Output a line ending failure message
-void badLineEnding(const FilePath& fpath, int line) {
-	std::cout << "Bad line ending in " << fpath.str().toUtf8() << " at line " << line << std::endl;
+// Add a line ending failure message to a report
+void badLineEnding(std::string& report, const FilePath& fpath, int line) {
+	report += "Bad line ending in " + fpath.str().toUtf8() + " at line " + std::to_string(line) + "\n";
 }
 
-// Check all the line endings in a file.
-void checkLineEndings(FilePath fpath) {
-	FileEncodedInputPtr fin = FileEncodedInput::open(CharEncoding::DEFAULT, fpath);
-	if (fin->getCharEncoding() != CharEncoding::DEFAULT) {
-		std::cout << "File " << fpath.str().toUtf8() << " has a file encoding of " 
-			<< fin->getCharEncoding().getName().toUtf8() << std::endl;
-	}
+// Check the line endings in text where '\r' and '\n' are single bytes
+// (UTF8 and the code pages).
+void checkRawLineEndings(std::string& report, const FilePath& fpath, const char* begin, const char* end) {
 	int line = 1;
+#ifdef WINDOWS_LINE_ENDINGS
+	// Every line ending must be \r\n
+	const char* p = begin;
 	for (;;) {
-		// Linux line endings
-		Char ch = fin->read();
-		if (ch.isEof()) {
+		p += Utf8Scan::newlinePrefixLength(p, (Uint)(end - p));
+		if (p == end) {
 			break;
 		}
-		if (ch == '\n') {
-			++line;
+		if ((*p == '\r') && (p + 1 != end) && (p[1] == '\n')) {
+			p += 2;
 		}
-		if (ch == '\r') {
-			badLineEnding(fpath, line);
+		else {
+			badLineEnding(report, fpath, line);
+			++p;
 		}
+		++line;
+	}
+#else
+	// There must be no '\r'. Line numbers are only needed for reports so
+	// the newlines are only counted up to each '\r' found.
+	const char* counted = begin;
+	for (const char* p = begin; (p = (const char*)memchr(p, '\r', end - p)) != nullptr; ++p) {
+		line += (int)std::count(counted, p, '\n');
+		counted = p;
+		badLineEnding(report, fpath, line);
+	}
+#endif
+}
 
-#ifdef WINDOWS_LINE_ENDINGS
-		if (ch == '\n') {
-			badLineEnding(fpath, line);
-		}
-		if (ch == '\r') {
-			ch = fin->read();
-			if (ch != '\n') {
-				badLineEnding(fpath, line);
-			}
-			++line;
+// A conversion error handler which throws
+class LocalCharInputConverterErrorHandler : public CharInputConverterErrorHandler {
+public:
+	void cannotEncodeForInput(const std::string& hexChar) { throw String("cannot encode file for input"); }
+};
+
+// Check all the line endings in a file and add any failures to the report.
+// The raw bytes are scanned directly unless the file has a BOM for a multibyte
+// encoding in which case it is converted to UTF8 first. A character which is
+// not valid in the file's encoding throws as it did when files were read
+// through FileEncodedInput.
+void checkLineEndings(std::string& report, FilePath fpath) {
+	FileBinaryInputPtr fin = FileBinaryInput::open(fpath);
+	const char* data;
+	Uint size = std::numeric_limits<Uint>::max();
+	std::string contents;
+	if (!fin->view(data, size)) {
+		contents = fin->readString();
+		data = contents.data();
+		size = (Uint)contents.size();
+	}
+
+	Uint bomSize;
+	CharEncoding encoding = CharEncoding::fromBom(data, size, bomSize);
+	if (!encoding.isValid()) {
+		encoding = CharEncoding::DEFAULT;
+	}
+	if (encoding != CharEncoding::DEFAULT) {
+		report += "File " + fpath.str().toUtf8() + " has a file encoding of " 
+			+ encoding.getName().toUtf8() + "\n";
+	}
+
+	CharInputConverterPtr converter = CharInputConverter::create(
+		encoding,
+		std::make_shared<LocalCharInputConverterErrorHandler>(),
+		Char(' '));
+	switch (encoding.getOrdinal()) {
+	case CharEncoding::UTF16BE:
+	case CharEncoding::UTF16LE:
+	case CharEncoding::UTF32BE:
+	case CharEncoding::UTF32LE:
+		{
+			std::string text = converter->convertString(data + bomSize, size - bomSize).toUtf8();
+			checkRawLineEndings(report, fpath, text.data(), text.data() + text.size());
 		}
-#endif
+		break;
+	default:
+		// The text is only decoded to check that it is valid since '\r' and
+		// '\n' are single bytes in these encodings
+		converter->convertString(data + bomSize, size - bomSize);
+		checkRawLineEndings(report, fpath, data + bomSize, data + size);
+		break;
 	}
 }
 
@@ -83,7 +144,7 @@ public:
 	void writeError(const FilePath& path) { throw String("file write error"); }
 };
 
-void doMain() {
+void doMain(Uint threadCount) {
 	DirPath srcDir = TestFile::getSrcDir("");
 	if (!srcDir.exists()) {
 		throw String("cannot find source directory");
@@ -95,20 +156,27 @@ void doMain() {
 	std::vector<FilePath> cppFileList;
 	findCppFiles(cppFileList, srcDir);
 
-	for (auto fp : cppFileList) {
-		checkLineEndings(fp);
+	// Check the files in parallel. The reports are kept per file and output
+	// in file list order so the output does not depend on the threads.
+	std::vector<std::string> reports(cppFileList.size());
+	WorkStealingPool::run((Uint)cppFileList.size(), threadCount, [&](Uint index, Uint thread) {
+		checkLineEndings(reports[index], cppFileList[index]);
+	});
+
+	for (auto& report : reports) {
+		std::cout << report;
 	}
+	std::cout.flush();
 }
 
 // A utility program to check that all .cpp and .hpp source files have \r\n line endings.
 // Also checks for files with an initial BOM.
+// Usage: CheckLineEndings.exe [-j N]
+// where N is the number of threads to check files with (default
+// is the hardware concurrency).
 int main(int argc, char** argv) {
 	try {
-		if (argc != 1) {
-			throw String("no arguments expected for CheckLineEndings.exe");
-		}
-	
-		doMain();
+		doMain(ToolArgs::threadCountFromArgs(argc, argv, "usage: CheckLineEndings.exe [-j N]"));
 	}
 	catch (String& ex) {
 		scout << "Error: " << ex << sendl;
@@ -120,4 +188,3 @@ int main(int argc, char** argv) {
 [[noreturn]] void doAssertFail(std::uint32_t fileLineHash) {
 	throw String("assertion error");
 }
-
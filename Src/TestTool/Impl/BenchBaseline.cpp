@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include "TestTool/Impl/BenchBaseline.hpp"
+#include "TestTool/Impl/BenchRunner.hpp"
+#include "Util/File.hpp"
+
+BenchBaseline::BenchBaseline() :
+	results_(),
+	order_()
+{
+}
+
+bool BenchBaseline::load(const FilePath& path) {
+	results_.clear();
+	order_.clear();
+	if (!path.exists()) {
+		return false;
+	}
+	std::istringstream ss(FileBinaryInput::open(path)->readString());
+	std::string line;
+	while (std::getline(ss, line)) {
+		if (!line.empty() && (line.back() == '\r')) {
+			line.pop_back();
+		}
+
+		// The file name may contain commas so take the other fields from
+		// the end of the line.
+		std::string::size_type commas[4];
+		std::string::size_type pos = line.size();
+		bool valid = true;
+		for (int i = 3; valid && (i >= 0); i--) {
+			commas[i] = (pos == 0) ? std::string::npos : line.rfind(',', pos - 1);
+			valid = (commas[i] != std::string::npos);
+			pos = commas[i];
+		}
+		if (!valid) {
+			continue;
+		}
+		BenchResult result;
+		std::string file = line.substr(0, commas[0]);
+		int lineNumber = std::atoi(line.c_str() + commas[0] + 1);
+		result.iterations = std::strtoull(line.c_str() + commas[1] + 1, nullptr, 10);
+		result.bytesPerIteration = std::strtoull(line.c_str() + commas[2] + 1, nullptr, 10);
+		std::istringstream samples(line.substr(commas[3] + 1));
+		Float64 sample;
+		while (samples >> sample) {
+			result.samples.push_back(sample);
+		}
+		if ((lineNumber <= 0) || result.samples.empty()) {
+			continue;
+		}
+		BenchRunner::calculate(result);
+		set(String(file), lineNumber, result);
+	}
+	return true;
+}
+
+void BenchBaseline::save(const FilePath& path) const {
+	std::ostringstream ss;
+	for (const String& k : order_) {
+		const BenchResult& result = results_.find(k)->second;
+		std::string name = k.toUtf8();
+		std::string::size_type bracket = name.rfind('(');
+		ss	<< name.substr(0, bracket) << "," 
+			<< name.substr(bracket + 1, name.size() - bracket - 2) << ","
+			<< result.iterations << ","
+			<< result.bytesPerIteration << ",";
+		for (Uint i = 0; i < result.samples.size(); i++) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%s%.3f", (i == 0) ? "" : " ", result.samples[i]);
+			ss << buf;
+		}
+		ss << "\n";
+	}
+	FileBinaryOutputPtr out = FileBinaryOutput::create(path);
+	out->write(ss.str());
+	out->close();
+}
+
+void BenchBaseline::set(const String& file, int line, const BenchResult& result) {
+	String k = key(file, line);
+	if (results_.find(k) == results_.end()) {
+		order_.push_back(k);
+	}
+	results_[k] = result;
+}
+
+const BenchResult* BenchBaseline::find(const String& file, int line) const {
+	auto it = results_.find(key(file, line));
+	return (it != results_.end()) ? &it->second : nullptr;
+}
+
+Float64 BenchBaseline::slowerProbability(const BenchResult& baseline, const BenchResult& current) {
+	const std::vector<Float64>& a = baseline.samples;
+	const std::vector<Float64>& b = current.samples;
+	if (a.empty() || b.empty()) {
+		return 1;
+	}
+
+	// U counts the pairs where the current sample is slower (ties count a
+	// half). The normal approximation with a continuity correction and a
+	// correction for ties is good enough for the usual 10 samples each.
+	Float64 u = 0;
+	for (Float64 x : a) {
+		for (Float64 y : b) {
+			u += (y > x) ? 1.0 : ((y == x) ? 0.5 : 0.0);
+		}
+	}
+	std::vector<Float64> all = a;
+	all.insert(all.end(), b.begin(), b.end());
+	std::sort(all.begin(), all.end());
+	Float64 tieSum = 0;
+	for (Uint i = 0; i < all.size(); ) {
+		Uint j = i;
+		for (; (j < all.size()) && (all[j] == all[i]); j++) {
+		}
+		Float64 t = (Float64)(j - i);
+		tieSum += t * t * t - t;
+		i = j;
+	}
+	Float64 n1 = (Float64)a.size();
+	Float64 n2 = (Float64)b.size();
+	Float64 n = n1 + n2;
+	Float64 variance = (n1 * n2 / 12.0) * ((n + 1) - ((n > 1) ? tieSum / (n * (n - 1)) : 0));
+	if (variance <= 0) {
+		return 1;
+	}
+	Float64 z = (u - n1 * n2 / 2.0 - 0.5) / std::sqrt(variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+String BenchBaseline::key(const String& file, int line) {
+	String ret = file;
+	ret << "(" << line << ")";
+	return ret;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "TestTool/Impl/BenchResult.hpp"
+#include "Util/Def.hpp"
+#include "Util/String.hpp"
+
+class FilePath;
+
+// A set of benchmark results saved from an earlier run so that a later run
+// can be compared with them. The results are stored as a CSV file with one
+// line per benchmark of:
+//
+//		file,line,iterations,bytesPerIteration,sample sample sample...
+//
+// where the samples are the nanoseconds per iteration of each repetition.
+class BenchBaseline {
+public:
+	// Constructor. An empty baseline.
+	BenchBaseline();
+
+	// Load the results from a file replacing any existing results. Returns
+	// false (leaving the baseline empty) if the file does not exist. Lines
+	// which cannot be read are ignored.
+	bool load(const FilePath& path);
+
+	// Save the results to a file.
+	void save(const FilePath& path) const;
+
+	// Add or replace the results for a benchmark.
+	void set(const String& file, int line, const BenchResult& result);
+
+	// Get the results for a benchmark or null if there are none.
+	const BenchResult* find(const String& file, int line) const;
+
+	// Get the keys of all the benchmarks in the order they were added.
+	const std::vector<String>& getKeys() const { return order_; }
+
+	// Test whether "current" is slower than "baseline" using the one sided
+	// Mann-Whitney U test on their samples. Returns the probability of
+	// samples at least this much slower if there was no real difference.
+	// Returns 1 if either has no samples.
+	static Float64 slowerProbability(const BenchResult& baseline, const BenchResult& current);
+
+	// The key for a benchmark of "file(line)"
+	static String key(const String& file, int line);
+
+private:
+	std::unordered_map<String, BenchResult, StringHash> results_;	// The results by "file(line)"
+	std::vector<String> order_;		// The keys in the order added so that the file is stable
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "Util/Def.hpp"
+
+// The statistics for a benchmark which has been run.
+struct BenchResult {
+	BenchResult() : samples(), iterations(0), bytesPerIteration(0), mean(0), median(0), stddev(0) { }
+	std::vector<Float64> samples;	// The time per iteration in nanoseconds of each timed repetition
+	Uint64 iterations;				// The number of iterations in each repetition
+	Uint64 bytesPerIteration;		// Bytes processed per iteration or 0 if not set
+	Float64 mean;					// The mean of samples
+	Float64 median;					// The median of samples
+	Float64 stddev;					// The sample standard deviation of samples
+};
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "TestTool/Impl/BenchRunner.hpp"
+#include "TestTool/TestBenchmark.hpp"
+#include "Util/String.hpp"
+#include "Util/SystemCout.hpp"
+
+bool BenchRunner::run(TestUtil::BenchFunc benchFunc, BenchResult& result) {
+	BenchState state;
+	result = BenchResult();
+
+	// Find the number of iterations for a repetition to take at least the
+	// minimum time. The settings are made by the first call.
+	Uint64 iterations = 1;
+	Float64 elapsed = call(benchFunc, state, iterations);
+	if (!state.started_) {
+		return false;
+	}
+	if (state.fixedIterations_ > 0) {
+		iterations = state.fixedIterations_;
+	}
+	else {
+		Float64 minTime = (Float64)state.minTimeMs_ * 1e6;
+		while ((elapsed < minTime) && (iterations < MAX_ITERATIONS) && (TestUtil::getTestFailureCount() == 0)) {
+			// Aim a little beyond the minimum time but grow by at most 10 times
+			// since a short time is not an accurate guide.
+			Float64 multiplier = (elapsed > 0) ? std::min(minTime * 1.4 / elapsed, 10.0) : 10.0;
+			iterations = std::min(std::max(iterations + 1, (Uint64)((Float64)iterations * multiplier)), (Uint64)MAX_ITERATIONS);
+			elapsed = call(benchFunc, state, iterations);
+		}
+	}
+
+	// The warmup and timed repetitions
+	for (Uint i = 0; (i < state.warmupRepetitions_) && (TestUtil::getTestFailureCount() == 0); i++) {
+		call(benchFunc, state, iterations);
+	}
+	for (Uint i = 0; (i < std::max(state.repetitions_, 1u)) && (TestUtil::getTestFailureCount() == 0); i++) {
+		result.samples.push_back(call(benchFunc, state, iterations) / (Float64)iterations);
+	}
+	if (TestUtil::getTestFailureCount() > 0) {
+		return true;
+	}
+	result.iterations = iterations;
+	result.bytesPerIteration = state.bytesPerIteration_;
+	calculate(result);
+
+	char buf[200];
+	snprintf(buf, sizeof(buf), "mean %.2f ns/op, median %.2f ns/op, stddev %.2f ns/op (%.1f%%)", 
+		result.mean, result.median, result.stddev, (result.mean > 0) ? 100.0 * result.stddev / result.mean : 0.0);
+	String line(buf);
+	if ((result.bytesPerIteration > 0) && (result.median > 0)) {
+		snprintf(buf, sizeof(buf), ", %.1f MB/s", (Float64)result.bytesPerIteration * 1e3 / result.median);
+		line += String(buf);
+	}
+	snprintf(buf, sizeof(buf), ", %u x %llu iterations", (Uint)result.samples.size(), (unsigned long long)iterations);
+	line += String(buf);
+	scout << line << sendl;
+	return true;
+}
+
+void BenchRunner::calculate(BenchResult& result) {
+	std::vector<Float64> sorted = result.samples;
+	if (sorted.empty()) {
+		return;
+	}
+	std::sort(sorted.begin(), sorted.end());
+	Uint n = (Uint)sorted.size();
+	result.median = (n % 2 == 1) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+	Float64 sum = 0;
+	for (Float64 sample : sorted) {
+		sum += sample;
+	}
+	result.mean = sum / n;
+	Float64 squares = 0;
+	for (Float64 sample : sorted) {
+		squares += (sample - result.mean) * (sample - result.mean);
+	}
+	result.stddev = (n > 1) ? std::sqrt(squares / (n - 1)) : 0;
+}
+
+Float64 BenchRunner::call(TestUtil::BenchFunc benchFunc, BenchState& state, Uint64 iterations) {
+	state.iterations_ = iterations;
+	state.remaining_ = iterations;
+	state.started_ = false;
+	state.running_ = false;
+	state.elapsed_ = std::chrono::steady_clock::duration::zero();
+	(*benchFunc)(state);
+	state.stopTimer();
+	return (Float64)std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed_).count();
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "TestTool/Impl/BenchResult.hpp"
+#include "TestTool/TestUtil.hpp"
+#include "Util/Def.hpp"
+
+// Runs a benchmark function following the settings in its BenchState and
+// calculates the statistics.
+class BenchRunner {
+public:
+	// Run the benchmark and display the statistics. Returns false if the
+	// benchmark did not call BenchState::keepRunning(). Stops early without
+	// statistics if the benchmark has a test failure.
+	static bool run(TestUtil::BenchFunc benchFunc, BenchResult& result);
+
+	// Calculate the mean, median and standard deviation of result.samples.
+	static void calculate(BenchResult& result);
+
+private:
+	// The most iterations in a repetition
+	static const Uint64 MAX_ITERATIONS = 1000000000u;
+
+	// Call the benchmark function to run "iterations" iterations and return
+	// the time taken in nanoseconds.
+	static Float64 call(TestUtil::BenchFunc benchFunc, BenchState& state, Uint64 iterations);
+};
@@ -0,0 +1,135 @@
+#include <cstring>
+#include "TestTool/ScanCache.hpp"
+#include "TestTool/TestFile.hpp"
+#include "Util/File.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Local
+///////////////////////////////////////////////////////////////////////////////
+
+// The cache file starts with this tag and version. Change the version if the
+// scanning or the file format changes so that old caches are discarded.
+static const char* const CACHE_TAG = "AHMC";
+static const Uint32 CACHE_VERSION = 1;
+
+// Append a binary value to a buffer.
+template <typename T>
+static void putValue(std::string& dst, T value) {
+	dst.append((const char*)&value, sizeof(T));
+}
+
+// Get a binary value from a buffer at position pos and advance pos.
+// Returns false if there are not enough bytes.
+template <typename T>
+static bool getValue(const std::string& src, size_t& pos, T& value) {
+	if (src.size() - pos < sizeof(T)) {
+		return false;
+	}
+	memcpy(&value, src.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ScanCache
+///////////////////////////////////////////////////////////////////////////////
+
+ScanCache::ScanCache() : 
+	entries_()
+{
+}
+
+ScanCache ScanCache::load(const FilePath& cacheFile) {
+	if (!cacheFile.exists()) {
+		return ScanCache();
+	}
+	std::string data = FileBinaryInput::open(cacheFile)->readString();
+
+	size_t pos = strlen(CACHE_TAG);
+	Uint32 version;
+	Uint32 count;
+	if ((data.compare(0, pos, CACHE_TAG) != 0) ||
+		!getValue(data, pos, version) ||
+		(version != CACHE_VERSION) ||
+		!getValue(data, pos, count))
+	{
+		return ScanCache();
+	}
+
+	ScanCache cache;
+	for (Uint32 i = 0; i < count; i++) {
+		Uint32 keySize;
+		if (!getValue(data, pos, keySize) || (data.size() - pos < keySize)) {
+			return ScanCache();
+		}
+		std::string key = data.substr(pos, keySize);
+		pos += keySize;
+
+		Entry entry;
+		Uint32 lineCount;
+		if (!getValue(data, pos, entry.size) ||
+			!getValue(data, pos, entry.modifiedTime) ||
+			!getValue(data, pos, lineCount))
+		{
+			return ScanCache();
+		}
+		for (Uint32 j = 0; j < lineCount; j++) {
+			Int32 line;
+			if (!getValue(data, pos, line)) {
+				return ScanCache();
+			}
+			entry.lines.push_back(line);
+		}
+		cache.entries_[key] = entry;
+	}
+	return cache;
+}
+
+void ScanCache::save(const FilePath& cacheFile) const {
+	std::string data = CACHE_TAG;
+	putValue(data, CACHE_VERSION);
+	putValue(data, (Uint32)entries_.size());
+	for (auto& pr : entries_) {
+		putValue(data, (Uint32)pr.first.size());
+		data += pr.first;
+		putValue(data, pr.second.size);
+		putValue(data, pr.second.modifiedTime);
+		putValue(data, (Uint32)pr.second.lines.size());
+		for (int line : pr.second.lines) {
+			putValue(data, (Int32)line);
+		}
+	}
+	TestFile::createBinaryTestFile(cacheFile, data);
+}
+
+bool ScanCache::find(const std::string& key, Uint64 size, Int64 modifiedTime, std::vector<int>& lines) const {
+	auto it = entries_.find(key);
+	if ((it == entries_.end()) || (it->second.size != size) || (it->second.modifiedTime != modifiedTime)) {
+		return false;
+	}
+	lines = it->second.lines;
+	return true;
+}
+
+void ScanCache::set(const std::string& key, Uint64 size, Int64 modifiedTime, const std::vector<int>& lines) {
+	Entry& entry = entries_[key];
+	entry.size = size;
+	entry.modifiedTime = modifiedTime;
+	entry.lines = lines;
+}
+
+void ScanCache::merge(const ScanCache& other) {
+	entries_.insert(other.entries_.begin(), other.entries_.end());
+}
+
+bool ScanCache::contains(const std::string& key) const {
+	return entries_.find(key) != entries_.end();
+}
+
+std::vector<std::string> ScanCache::keys() const {
+	std::vector<std::string> ret;
+	for (auto& pr : entries_) {
+		ret.push_back(pr.first);
+	}
+	return ret;
+}
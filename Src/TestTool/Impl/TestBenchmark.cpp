@@ -0,0 +1,50 @@
+#include "TestTool/Impl/TestCase.hpp"
+#include "TestTool/Impl/TestManager.hpp"
+#include "TestTool/TestBenchmark.hpp"
+
+BenchState::BenchState() :
+	iterations_(0),
+	remaining_(0),
+	started_(false),
+	running_(false),
+	startTime_(),
+	elapsed_(std::chrono::steady_clock::duration::zero()),
+	bytesPerIteration_(0),
+	repetitions_(DEFAULT_REPETITIONS),
+	warmupRepetitions_(DEFAULT_WARMUP_REPETITIONS),
+	minTimeMs_(DEFAULT_MIN_TIME_MS),
+	fixedIterations_(0)
+{
+}
+
+void BenchState::pauseTiming() {
+	stopTimer();
+}
+
+void BenchState::resumeTiming() {
+	if (started_ && !running_) {
+		running_ = true;
+		startTime_ = std::chrono::steady_clock::now();
+	}
+}
+
+void BenchState::startTimer() {
+	started_ = true;
+	running_ = true;
+	startTime_ = std::chrono::steady_clock::now();
+}
+
+void BenchState::stopTimer() {
+	if (running_) {
+		elapsed_ += std::chrono::steady_clock::now() - startTime_;
+		running_ = false;
+	}
+}
+
+namespace TestUtil {
+
+	BenchmarkRegistrar::BenchmarkRegistrar(const char* file, int line, BenchFunc benchFunc) {
+		TestManager::instance().addTest(new TestCase(file, line, benchFunc));
+	}
+
+}
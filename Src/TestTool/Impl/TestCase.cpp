@@ -1,4 +1,5 @@
 #include <iostream>
+#include "TestTool/Impl/BenchRunner.hpp"
 #include "TestTool/Impl/TestAbortException.hpp"
 #include "TestTool/Impl/TestCase.hpp"
 #include "Util/Assert.hpp"
@@ -9,10 +10,29 @@ TestCase::TestCase(const char* file, int line, TestUtil::TestFunc testFunc) :
 	testFilename_(),
 	testLineNumber_(line),
 	testFunc_(testFunc),
+	benchFunc_(nullptr),
+	benchResult_(),
 	whatException_(),
 	expectedEvents_(),
 	failureCount_(0)
 {
+	init(file);
+}
+
+TestCase::TestCase(const char* file, int line, TestUtil::BenchFunc benchFunc) :
+	testFilename_(),
+	testLineNumber_(line),
+	testFunc_(nullptr),
+	benchFunc_(benchFunc),
+	benchResult_(),
+	whatException_(),
+	expectedEvents_(),
+	failureCount_(0)
+{
+	init(file);
+}
+
+void TestCase::init(const char* file) {
 	// Convert to lowercase. Windows does this anyway so we need to do it across all
 	// platforms to allow correct testing for particular filenames.
 	String fullFile = String(file).toLowerCopy();
@@ -47,7 +67,15 @@ TestCase::TestCase(const char* file, int line, TestUtil::TestFunc testFunc) :
 bool TestCase::run() {
 	scout << "===== " << testFilename_ << "(" << testLineNumber_ << ")" << " =====" << sendl;
 	try {
-		(*testFunc_)();
+		if (benchFunc_ != nullptr) {
+			if (!BenchRunner::run(benchFunc_, benchResult_)) {
+				scout << "TEST ERROR: The benchmark did not call BenchState::keepRunning()" << sendl;
+				incrementFailureCount();
+			}
+		}
+		else {
+			(*testFunc_)();
+		}
 
 		// The test has completed so all events and exceptions should have occurred.
 		expectNothing();
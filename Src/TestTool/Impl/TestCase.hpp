@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include "TestTool/Impl/BenchResult.hpp"
 #include "TestTool/TestUtil.hpp"
 
 // A single test case.
@@ -12,7 +13,12 @@ public:
 	// testFunc: The test function to run the test
 	TestCase(const char* file, int line, TestUtil::TestFunc testFunc);
 
-	// Run the test and return true on success.
+	// The benchmark constructor. The arguments are as above but with the
+	// benchmark function to run.
+	TestCase(const char* file, int line, TestUtil::BenchFunc benchFunc);
+
+	// Run the test and return true on success. A benchmark is run by
+	// BenchRunner and its statistics are kept for getBenchResult().
 	bool run();
 
 	// Notify the current test case to expect an event. These event notifications
@@ -66,16 +72,27 @@ public:
 	// Get the number of failures in the test
 	Uint getFailureCount() const { return failureCount_; }
 
+	// True if this is a benchmark rather than a test
+	bool isBenchmark() const { return benchFunc_ != nullptr; }
+
+	// Get the statistics from the last run of a benchmark
+	const BenchResult& getBenchResult() const { return benchResult_; }
+
 private:
 	template<typename X> void testValueOutput(X x);
 	inline void testValueOutput(std::string x);
 	inline void incrementFailureCount();
 
+	// Set the test filename from the file supplied to the constructor.
+	void init(const char* file);
+
 private:
 	String testFilename_;			// The source file for the test (stripped of path up to /src/
 									// and all in lower case).
 	int testLineNumber_;			// The source line number for the start of the test
-	TestUtil::TestFunc testFunc_;	// The test function
+	TestUtil::TestFunc testFunc_;	// The test function or null for a benchmark
+	TestUtil::BenchFunc benchFunc_;	// The benchmark function or null for a test
+	BenchResult benchResult_;		// The statistics from the last run of a benchmark
 	String whatException_;			// The what() for an exception which is expected for the 
 									// test or empty if no exception is expected.
 	std::vector<TestEventPtr> expectedEvents_;	// The expected events
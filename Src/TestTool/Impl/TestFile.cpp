@@ -24,14 +24,13 @@ namespace TestFile {
 	// Convert a std::filesystem file path to a String handling
 	// non-ASCII characters correctly.
 	static String fsToString(const fs::path& fsPath) {
-		std::string s = fsPath.u8string();
-		return String(s);
+		return String::fromPlatform(fsPath.native());
 	}
 
 	// Convert a String to a std::filesystem file path handling
 	// non-ASCII characters correctly.
 	static fs::path stringToFs(const String& strPath) {
-		return fs::u8path(strPath.toUtf8());
+		return fs::path(strPath.toPlatform());
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
@@ -1,14 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <limits>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
+#include "TestTool/Impl/BenchBaseline.hpp"
 #include "TestTool/Impl/TestAbortException.hpp"
 #include "TestTool/Impl/TestCase.hpp"
 #include "TestTool/Impl/TestManager.hpp"
+#include "TestTool/Impl/TestProcess.hpp"
 #include "TestTool/TestCustomise.hpp"
 #include "TestTool/TestFile.hpp"
 #include "Util/Assert.hpp"
+#include "Util/CharInputConverter.hpp"
+#include "Util/File.hpp"
 #include "Util/SystemCout.hpp"
+#include "Util/Windows.hpp"
+#include "Util/WorkStealingPool.hpp"
+
+#if BUILD(LINUX)
+#include <time.h>
+#endif
+
+namespace {
+	// The test case being run by the current thread or null.
+	thread_local TestCase* currentTestCase = nullptr;
+
+	// The virtual file system namespaces for tests run in parallel. Each test
+	// takes one which no running test is using so that nested runs (as in
+	// TestToolTest) never share a namespace with a test which is still
+	// running. It is returned when the test ends and reused by a later test,
+	// so the number of namespaces is only the number of tests ever running
+	// at once. The namespaces themselves are never freed (see
+	// FileSystemVirtual).
+	std::mutex virtualNamespacesMutex;
+	std::vector<Uint> freeVirtualNamespaces;
+	Uint virtualNamespaceCount = 0;
+
+	// The lines written by a supervised worker process before and after each
+	// test followed by the index of the test (and after it the failure count).
+	const char* const START_MARKER = "#@TEST-START ";
+	const char* const END_MARKER = "#@TEST-END ";
+
+	// The name of the benchmark baseline file in the project test directory
+	const char* const BASELINE_FILE = "benchmarks.csv";
+
+	// The probability below which a benchmark which is slower than its
+	// baseline is taken to be really slower rather than just noisy
+	const Float64 REGRESSION_SIGNIFICANCE = 0.01;
+
+	// Get the CPU time used by the calling thread in nanoseconds.
+	Uint64 threadCpuTime() {
+#if BUILD(WINDOWS)
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+			return 0;
+		}
+		// The times are in units of 100ns
+		Uint64 kernel = ((Uint64)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+		Uint64 user = ((Uint64)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+		return (kernel + user) * 100u;
+#elif BUILD(LINUX)
+		timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+			return 0;
+		}
+		return (Uint64)ts.tv_sec * 1000000000u + (Uint64)ts.tv_nsec;
+#else
+#error "Illegal build"
+#endif
+	}
+
+	// The options which take a value (see TestManager::isValueOption())
+	const char* const VALUE_OPTIONS[] = {
+		"--jobs", "--processes", "--timeout", "--start-after", "--shard",
+		"--slowest", "--baseline", "--regression", "--results"
+	};
+
+	// An output stream which writes UTF8 straight to the standard output
+	// and flushes it at the end of each line.
+	class Utf8Cout : public OutputStream {
+	public:
+		Utf8Cout() : atLineStart_(true) { }
+		void streamChar(Char ch) {
+			char utf8[4];
+			Uint len = ch.toUtf8(utf8);
+			std::cout.write(utf8, len);
+			atLineStart_ = (ch == '\n');
+			if (atLineStart_) {
+				std::cout.flush();
+			}
+		}
+
+		// End the current line unless nothing has been written to it
+		void endLine() {
+			if (!atLineStart_) {
+				streamChar(Char('\n'));
+			}
+		}
+
+	private:
+		bool atLineStart_;
+	};
+
+	// The following set some state of the calling thread for the life of the
+	// object and restore it on destruction, so that it is restored even if a
+	// test throws.
+
+	// Sets the current test case.
+	class CurrentTestCase {
+	public:
+		explicit CurrentTestCase(TestCase* testCase) : previous_(currentTestCase) { currentTestCase = testCase; }
+		~CurrentTestCase() { currentTestCase = previous_; }
+	private:
+		TestCase* previous_;
+	};
+
+	// Captures the scout output (see SystemCout::setThreadCapture()).
+	class ThreadCapture {
+	public:
+		explicit ThreadCapture(OutputStream* capture) : previous_(SystemCout::setThreadCapture(capture)) { }
+		~ThreadCapture() { SystemCout::setThreadCapture(previous_); }
+	private:
+		OutputStream* previous_;
+	};
+
+	// Selects a virtual file system namespace which is not in use. On
+	// destruction the virtual file system in it is stopped and the namespace
+	// can be reused.
+	class VirtualNamespace {
+	public:
+		VirtualNamespace() : ns_(acquire()), previous_(FileSystem::getVirtualNamespace()) { FileSystem::setVirtualNamespace(ns_); }
+		~VirtualNamespace() {
+			FileSystem::stopVirtualFileSystem();
+			FileSystem::setVirtualNamespace(previous_);
+			std::lock_guard<std::mutex> lock(virtualNamespacesMutex);
+			freeVirtualNamespaces.push_back(ns_);
+		}
+	private:
+		static Uint acquire() {
+			std::lock_guard<std::mutex> lock(virtualNamespacesMutex);
+			if (freeVirtualNamespaces.empty()) {
+				return ++virtualNamespaceCount;
+			}
+			Uint ns = freeVirtualNamespaces.back();
+			freeVirtualNamespaces.pop_back();
+			return ns;
+		}
+		Uint ns_;
+		Uint previous_;
+	};
+}
 
 TestManager& TestManager::instance() {
 	static TestManager theInstance;
@@ -32,16 +181,93 @@ bool TestManager::runTests(const char* projectName, int argc, const char** argv,
 	// Make sure that the test output directory exists
 	TestFile::createTestDir(projectTestDir);
 
-	if (customise) {
-		customise->beforeAllTests();
-	}
-
 	// Get a list of tests to run if supplied. If empty then run
 	// everything. The pair second argument is the line number or -1 to match
-	// all lines in file.
+	// all lines in file. Options starting with "--" take a value either in
+	// the same argument after "=" or in the next argument apart from
+	// "--supervised" and "--bench" which take no value or (for "--bench") an
+	// optional value after "=".
 	std::vector<std::pair<String, int>> testsToRun;
+	std::vector<std::string> filterArgs;
+	Uint jobs = 1;
+	Uint processes = 0;
+	Uint shard = 0;
+	Uint shardCount = 1;
+	Uint timeout = DEFAULT_TIMEOUT;
+	bool supervised = false;
+	Uint slowestCount = DEFAULT_SLOWEST_COUNT;
+	std::string resultsFile;
+	Uint startAfter = 0;
+	bool hasStartAfter = false;
+	bool bench = false;
+	String benchFilter;
+	std::string baselineMode;
+	Uint regressionPercent = DEFAULT_REGRESSION_PERCENT;
 	for (int i = 1; i < argc; i++) {
 		std::string s = argv[i];
+		if ((s == "--bench") || (s.compare(0, 8, "--bench=") == 0)) {
+			bench = true;
+			benchFilter = String(s.substr(std::min(s.size(), (std::string::size_type)8))).toLowerCopy();
+			continue;
+		}
+		if (s == "--supervised") {
+			supervised = true;
+			continue;
+		}
+		if (s.compare(0, 2, "--") == 0) {
+			std::string name = s;
+			std::string value;
+			std::string::size_type equals = s.find('=');
+			if (equals != std::string::npos) {
+				name = s.substr(0, equals);
+				value = s.substr(equals + 1);
+			}
+			else if (isValueOption(name) && (i + 1 < argc)) {
+				value = argv[++i];
+			}
+			Uint count = parseCount(value);
+			bool valid = (count != INVALID_COUNT);
+			if (name == "--jobs") {
+				valid = valid && (count > 0);
+				jobs = valid ? count : jobs;
+			}
+			else if (name == "--processes") {
+				valid = valid && (count > 0);
+				processes = valid ? count : processes;
+			}
+			else if (name == "--timeout") {
+				timeout = valid ? count : timeout;
+			}
+			else if (name == "--start-after") {
+				startAfter = valid ? count : startAfter;
+				hasStartAfter = hasStartAfter || valid;
+			}
+			else if (name == "--shard") {
+				valid = parseShard(value, shard, shardCount);
+			}
+			else if (name == "--slowest") {
+				slowestCount = valid ? count : slowestCount;
+			}
+			else if (name == "--baseline") {
+				valid = (value == "save") || (value == "compare");
+				baselineMode = valid ? value : baselineMode;
+			}
+			else if (name == "--regression") {
+				regressionPercent = valid ? count : regressionPercent;
+			}
+			else if (name == "--results") {
+				valid = !value.empty();
+				resultsFile = value;
+			}
+			else {
+				valid = false;
+			}
+			if (!valid) {
+				scout << "Invalid command line argument of " << String(s) << sendl;
+			}
+			continue;
+		}
+		filterArgs.push_back(s);
 		std::string::size_type pos = s.find('(');
 		if (pos == std::string::npos) {
 			testsToRun.push_back(std::make_pair(String(s), -1));
@@ -61,11 +287,39 @@ bool TestManager::runTests(const char* projectName, int argc, const char** argv,
 		}
 	}
 
-	// Run all the tests or just the selected ones if arguments were supplied.
-	std::vector<Uint> failedTestIndexes;
-	Uint testCount = 0;
-	for (currentTestIndex_ = 0; currentTestIndex_ < tests_.size(); currentTestIndex_++) {
-		TestCase* testCase = tests_[currentTestIndex_];
+	// A baseline is only for benchmarks
+	if (!baselineMode.empty() && !bench) {
+		scout << "Invalid command line argument of --baseline without --bench" << sendl;
+	}
+
+	// Benchmarks are always run one at a time in this process so that their
+	// timings are not disturbed by other tests.
+	if (bench) {
+		jobs = 1;
+		processes = 0;
+	}
+
+	// Select all the tests (or benchmarks) or just the ones matching the
+	// arguments. A shard takes every shardCount'th of these tests. The
+	// supervisor selects all the tests since it passes the shards to its workers.
+	if (processes > 0) {
+		shard = 0;
+		shardCount = 1;
+		hasStartAfter = false;
+	}
+	std::vector<Uint> matchingTestIndexes;
+	for (Uint index = 0; index < tests_.size(); index++) {
+		TestCase* testCase = tests_[index];
+		if (testCase->isBenchmark() != bench) {
+			continue;
+		}
+		if (!benchFilter.empty()) {
+			String name = testCase->getTestFilename();
+			name << "(" << testCase->getTestLineNumber() << ")";
+			if (name.findFirst(benchFilter).atEnd()) {
+				continue;
+			}
+		}
 		if (!testsToRun.empty()) {
 			bool match = false;
 			for (auto it = testsToRun.begin(); it != testsToRun.end(); it++) {
@@ -80,36 +334,78 @@ bool TestManager::runTests(const char* projectName, int argc, const char** argv,
 				continue;
 			}
 		}
+		matchingTestIndexes.push_back(index);
+	}
+	std::vector<Uint> selectedTestIndexes = selectShard(matchingTestIndexes, shard, shardCount);
+	if (hasStartAfter) {
+		selectedTestIndexes = selectStartAfter(selectedTestIndexes, startAfter);
+	}
+
+	// Run the tests
+	std::vector<TestCase*> selectedTestCases;
+	for (Uint index : selectedTestIndexes) {
+		selectedTestCases.push_back(tests_[index]);
+	}
+	std::vector<TestResult> results;
+	if (processes > 0) {
+		runSupervisor(selectedTestIndexes, filterArgs, processes, timeout, results);
+	}
+	else {
 		if (customise) {
-			customise->beforeTestCase();
+			customise->beforeAllTests();
+		}
+		if (jobs == 1) {
+			runSerial(selectedTestIndexes, customise, supervised, results);
 		}
-		if (!testCase->run()) {
-			failedTestIndexes.push_back(currentTestIndex_);
+		else {
+			runParallel(selectedTestCases, jobs, customise, scout, results);
 		}
 		if (customise) {
-			customise->afterTestCase();
+			customise->afterAllTests();
 		}
-		testCount++;
 	}
 
-	if (customise) {
-		customise->afterAllTests();
+	// Display the slowest tests (not for a worker since its supervisor does
+	// this or for benchmarks) and write the results file.
+	if (!supervised && !bench) {
+		printSlowest(selectedTestCases, results, slowestCount, scout);
+	}
+	if (!resultsFile.empty()) {
+		writeResults(FilePath(String(resultsFile), FileSystem::getWorkingDir()), selectedTestCases, results);
+	}
+
+	// Compare the benchmarks with the baseline or save them as the baseline
+	if (bench && !baselineMode.empty()) {
+		checkBaseline(
+			FilePath(BASELINE_FILE, projectTestDir), 
+			selectedTestIndexes, 
+			baselineMode == "compare", 
+			baselineMode == "save", 
+			regressionPercent, 
+			results);
 	}
 
 	// Display a summary of all the errors
-	scout << "===== A total of " << testCount << " tests have been run =====" << sendl;
-	if (!failedTestIndexes.empty()) {
-		if (failedTestIndexes.size() == 1) {
+	Uint testCount = (Uint)selectedTestIndexes.size();
+	std::vector<Uint> failedTests;
+	for (Uint i = 0; i < testCount; i++) {
+		if (results[i].failureCount > 0) {
+			failedTests.push_back(i);
+		}
+	}
+	scout << "===== A total of " << testCount << (bench ? " benchmarks" : " tests") << " have been run =====" << sendl;
+	if (!failedTests.empty()) {
+		if (failedTests.size() == 1) {
 			scout << "The following test has failed:" << sendl;
 		}
 		else {
-			scout << "The following " << failedTestIndexes.size() << " tests have failed:" << sendl;
+			scout << "The following " << failedTests.size() << " tests have failed:" << sendl;
 		}
-		for (std::vector<Uint>::const_iterator it = failedTestIndexes.begin(); it != failedTestIndexes.end(); it++) {
-			TestCase* tc = tests_[*it];
+		for (std::vector<Uint>::const_iterator it = failedTests.begin(); it != failedTests.end(); it++) {
+			TestCase* tc = selectedTestCases[*it];
 			scout 
 				<< tc->getTestFilename() << "(" << tc->getTestLineNumber() << "): "
-				<< tc->getFailureCount() << " error(s)"
+				<< results[*it].failureCount << " error(s)"
 				<< sendl;
 		}
 	}
@@ -117,24 +413,487 @@ bool TestManager::runTests(const char* projectName, int argc, const char** argv,
 		scout << "All tests completed successfully" << sendl;
 	}
 
-	if (argc > 1) {
+	if (!filterArgs.empty() || !benchFilter.empty() || (shardCount > 1) || hasStartAfter) {
 		scout << "Warning: not all test cases were run due to command line argument(s)" << sendl;
 	}
 
-	return failedTestIndexes.empty();
+	return failedTests.empty();
 }
 
 TestCase* TestManager::getTestCase() {
-	if (currentTestIndex_ >= tests_.size()) {
+	TestCase* testCase = (currentTestCase != nullptr) ? currentTestCase : serialTestCase_;
+	if (testCase == nullptr) {
 		// Assertion error but we cannot use assert
 		scout << "TEST ERROR: assertion error in TestManager::getTestCase" << sendl;
 		throw TestAbortException();
 	}
-	return tests_[currentTestIndex_];
+	return testCase;
+}
+
+void TestManager::runTest(TestCase* testCase, TestCustomisePtr customise, TestResult& result) {
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	Uint64 startCpuTime = threadCpuTime();
+	bool success;
+	{
+		CurrentTestCase current(testCase);
+		if (customise) {
+			customise->beforeTestCase();
+		}
+		success = testCase->run();
+		if (customise) {
+			customise->afterTestCase();
+		}
+	}
+	result.failureCount = success ? 0 : std::max(testCase->getFailureCount(), 1u);
+	result.wallTime = (Uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - startTime).count();
+	result.cpuTime = threadCpuTime() - startCpuTime;
+}
+
+void TestManager::runSerial(
+	const std::vector<Uint>& testIndexes, 
+	TestCustomisePtr customise, 
+	bool supervised, 
+	std::vector<TestResult>& results) 
+{
+	// A supervised worker writes UTF8 straight to the standard output so that
+	// the supervisor sees the output of a test up to the point of a crash.
+	Utf8Cout utf8Cout;
+	std::unique_ptr<ThreadCapture> capture;
+	if (supervised) {
+		capture.reset(new ThreadCapture(&utf8Cout));
+	}
+
+	// Global state which tests may change is restored after each test so that
+	// a failing test cannot affect the tests after it.
+	FileSystemErrorHandlerPtr errorHandler = FileSystemErrorHandler::get();
+	results.assign(testIndexes.size(), TestResult());
+	for (Uint i = 0; i < testIndexes.size(); i++) {
+		serialTestCase_ = tests_[testIndexes[i]];
+		if (supervised) {
+			std::cout << START_MARKER << testIndexes[i] << std::endl;
+		}
+		runTest(serialTestCase_, customise, results[i]);
+		scout << sflush;
+		FileSystem::stopVirtualFileSystem();
+		FileSystemErrorHandler::set(errorHandler);
+		if (supervised) {
+			// The marker must be at the start of a line for the supervisor
+			utf8Cout.endLine();
+			std::cout << END_MARKER << testIndexes[i] << " " << results[i].failureCount 
+				<< " " << results[i].wallTime << " " << results[i].cpuTime << std::endl;
+		}
+	}
+	serialTestCase_ = nullptr;
+}
+
+void TestManager::runParallel(
+	const std::vector<TestCase*>& testCases, 
+	Uint jobs, 
+	TestCustomisePtr customise, 
+	OutputStream& out, 
+	std::vector<TestResult>& results) 
+{
+	// Each test case writes its output to its own buffer and the buffers are
+	// output in the test order as soon as all the tests before them have
+	// completed. So the output is the same as for a single job.
+	Uint testCount = (Uint)testCases.size();
+	results.assign(testCount, TestResult());
+	std::vector<String> outputs(testCount);
+	std::vector<bool> completed(testCount, false);
+	Uint nextOutput = 0;
+	std::mutex outputMutex;
+	WorkStealingPool::run(testCount, jobs, [&](Uint i, Uint) {
+		// Each test has its own virtual file system
+		String output;
+		TestResult result;
+		{
+			ThreadCapture capture(&output);
+			VirtualNamespace ns;
+			runTest(testCases[i], customise, result);
+		}
+
+		std::lock_guard<std::mutex> lock(outputMutex);
+		results[i] = result;
+		outputs[i] = std::move(output);
+		completed[i] = true;
+		for (; (nextOutput < testCount) && completed[nextOutput]; nextOutput++) {
+			out << outputs[nextOutput] << sflush;
+			outputs[nextOutput].clear();
+		}
+	});
+}
+
+void TestManager::runSupervisor(
+	const std::vector<Uint>& testIndexes, 
+	const std::vector<std::string>& filterArgs, 
+	Uint processes, 
+	Uint timeout, 
+	std::vector<TestResult>& results) 
+{
+	// Each worker process runs one shard of the selected tests and reports
+	// the start and end of each test with marker lines. The output of each test
+	// is collected and output in the test order as for a single process. If a
+	// worker crashes or a test takes too long then the test fails and a new
+	// worker continues with the rest of the shard.
+	struct Worker {
+		std::vector<Uint> positions;	// Positions in testIndexes of the tests in the shard
+		Uint next;						// Index into positions of the next test to complete
+		TestProcessPtr process;			// The worker process or null when the shard is complete
+		std::string pending;			// Incomplete line of output
+		bool running;					// True if positions[next] has started
+		std::chrono::steady_clock::time_point started;	// When positions[next] started
+	};
+	Uint testCount = (Uint)testIndexes.size();
+	results.assign(testCount, TestResult());
+	std::vector<String> outputs(testCount);
+	std::vector<bool> completed(testCount, false);
+	Uint nextOutput = 0;
+	CharInputConverterPtr converter = CharInputConverter::create(
+		CharEncoding::UTF8, CharInputConverterErrorHandlerPtr(), Char('?'));
+
+	std::vector<Worker> workers(std::min(processes, std::max(testCount, 1u)));
+	std::vector<Uint> allPositions(testCount);
+	for (Uint i = 0; i < testCount; i++) {
+		allPositions[i] = i;
+	}
+	for (Uint w = 0; w < workers.size(); w++) {
+		workers[w].positions = selectShard(allPositions, w, (Uint)workers.size());
+		workers[w].next = 0;
+		workers[w].running = false;
+	}
+
+	// Start (or restart) the worker for the remaining tests in its shard
+	auto startWorker = [&](Uint w) {
+		Worker& worker = workers[w];
+		worker.process.reset();
+		worker.pending.clear();
+		worker.running = false;
+		if (worker.next == worker.positions.size()) {
+			return;
+		}
+		std::vector<std::string> args = filterArgs;
+		args.push_back("--supervised");
+		args.push_back("--shard");
+		args.push_back(std::to_string(w) + "/" + std::to_string(workers.size()));
+		if (worker.next > 0) {
+			args.push_back("--start-after");
+			args.push_back(std::to_string(testIndexes[worker.positions[worker.next - 1]]));
+		}
+		worker.process = TestProcess::start(args);
+		if (!worker.process) {
+			scout << "TEST ERROR: Cannot start a test process" << sendl;
+			for (; worker.next < worker.positions.size(); worker.next++) {
+				results[worker.positions[worker.next]].failureCount = 1;
+				completed[worker.positions[worker.next]] = true;
+			}
+		}
+	};
+
+	// Fail the test which the worker is running (or due to run next)
+	auto failTest = [&](Uint w, const char* message) {
+		Worker& worker = workers[w];
+		Uint pos = worker.positions[worker.next];
+		if (!worker.pending.empty()) {
+			outputs[pos] += converter->convertString(worker.pending);
+			outputs[pos] += Char('\n');
+		}
+		outputs[pos] << "TEST ERROR: " << message << sendl;
+		results[pos].failureCount = 1;
+		if (worker.running) {
+			results[pos].wallTime = (Uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - worker.started).count();
+		}
+		completed[pos] = true;
+		worker.next++;
+		startWorker(w);
+	};
+
+	for (Uint w = 0; w < workers.size(); w++) {
+		startWorker(w);
+	}
+	for (;;) {
+		bool active = false;
+		for (Uint w = 0; w < workers.size(); w++) {
+			Worker& worker = workers[w];
+			if (!worker.process) {
+				continue;
+			}
+			active = true;
+			std::string data;
+			bool open = worker.process->read(data);
+
+			// Process the complete lines. Lines before the first test and after
+			// the last one are the worker's heading and summary and are dropped.
+			worker.pending += data;
+			bool protocolError = false;
+			std::string::size_type begin = 0;
+			std::string::size_type end;
+			while ((end = worker.pending.find('\n', begin)) != std::string::npos) {
+				std::string line = worker.pending.substr(begin, end - begin);
+				begin = end + 1;
+				if (!line.empty() && (line.back() == '\r')) {
+					line.pop_back();
+				}
+				if (line.compare(0, strlen(START_MARKER), START_MARKER) == 0) {
+					if (worker.running || (worker.next == worker.positions.size())) {
+						protocolError = true;
+						break;
+					}
+					worker.running = true;
+					worker.started = std::chrono::steady_clock::now();
+				}
+				else if (line.compare(0, strlen(END_MARKER), END_MARKER) == 0) {
+					if (!worker.running) {
+						protocolError = true;
+						break;
+					}
+					Uint pos = worker.positions[worker.next];
+					std::istringstream ss(line.substr(strlen(END_MARKER)));
+					Uint testIndex = 0;
+					ss >> testIndex >> results[pos].failureCount >> results[pos].wallTime >> results[pos].cpuTime;
+					if (!ss || (testIndex != testIndexes[pos])) {
+						protocolError = true;
+						break;
+					}
+					completed[pos] = true;
+					worker.next++;
+					worker.running = false;
+				}
+				else if (worker.running) {
+					Uint pos = worker.positions[worker.next];
+					outputs[pos] += converter->convertString(line);
+					outputs[pos] += Char('\n');
+				}
+			}
+			worker.pending.erase(0, begin);
+
+			// A worker which writes markers out of order is treated as if it
+			// had crashed
+			if (protocolError) {
+				worker.process->kill();
+				if (worker.next < worker.positions.size()) {
+					failTest(w, "Test process wrote an unexpected test marker");
+				}
+				else {
+					worker.process.reset();
+				}
+			}
+			else if (worker.running && (timeout > 0) &&
+				(std::chrono::steady_clock::now() - worker.started > std::chrono::seconds(timeout)))
+			{
+				worker.process->kill();
+				std::ostringstream message;
+				message << "Test timed out after " << timeout << " seconds";
+				failTest(w, message.str().c_str());
+			}
+			else if (!open) {
+				if (worker.next < worker.positions.size()) {
+					failTest(w, "Test process exited unexpectedly");
+				}
+				else {
+					worker.process.reset();
+				}
+			}
+		}
+
+		for (; (nextOutput < testCount) && completed[nextOutput]; nextOutput++) {
+			scout << outputs[nextOutput] << sflush;
+			outputs[nextOutput].clear();
+		}
+		if (!active) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+void TestManager::printSlowest(
+	const std::vector<TestCase*>& testCases, 
+	const std::vector<TestResult>& results, 
+	Uint count, 
+	OutputStream& out)
+{
+	std::vector<Uint> order(testCases.size());
+	for (Uint i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	count = std::min(count, (Uint)order.size());
+	if (count == 0) {
+		return;
+	}
+	std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](Uint a, Uint b) {
+		return results[a].wallTime > results[b].wallTime;
+	});
+	out << "===== The " << count << " slowest tests =====" << sendl;
+	for (Uint i = 0; i < count; i++) {
+		TestCase* tc = testCases[order[i]];
+		const TestResult& result = results[order[i]];
+		std::ostringstream times;
+		times.setf(std::ios::fixed);
+		times.precision(3);
+		times << (double)result.wallTime / 1e6 << " ms (CPU " << (double)result.cpuTime / 1e6 << " ms)";
+		out 
+			<< tc->getTestFilename() << "(" << tc->getTestLineNumber() << "): "
+			<< String(times.str())
+			<< sendl;
+	}
+}
+
+void TestManager::writeResults(
+	const FilePath& path, 
+	const std::vector<TestCase*>& testCases, 
+	const std::vector<TestResult>& results)
+{
+	// JSON with one object per test in the order run. The file name only
+	// needs escaping for quotes, backslashes and control characters.
+	std::ostringstream ss;
+	ss << "{\n\t\"tests\": [";
+	for (Uint i = 0; i < testCases.size(); i++) {
+		TestCase* tc = testCases[i];
+		std::string file;
+		for (char ch : tc->getTestFilename().toUtf8()) {
+			if ((ch == '"') || (ch == '\\')) {
+				file += '\\';
+				file += ch;
+			}
+			else if ((Uint8)ch < 0x20u) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", (Uint)(Uint8)ch);
+				file += buf;
+			}
+			else {
+				file += ch;
+			}
+		}
+		ss	<< ((i == 0) ? "\n" : ",\n")
+			<< "\t\t{ \"file\": \"" << file << "\", "
+			<< "\"line\": " << tc->getTestLineNumber() << ", "
+			<< "\"wallNs\": " << results[i].wallTime << ", "
+			<< "\"cpuNs\": " << results[i].cpuTime << ", "
+			<< "\"failures\": " << results[i].failureCount << " }";
+	}
+	ss << "\n\t]\n}\n";
+	FileBinaryOutputPtr out = FileBinaryOutput::create(path);
+	out->write(ss.str());
+	out->close();
+}
+
+void TestManager::checkBaseline(
+	const FilePath& path, 
+	const std::vector<Uint>& testIndexes, 
+	bool compare, 
+	bool save, 
+	Uint regressionPercent, 
+	std::vector<TestResult>& results)
+{
+	BenchBaseline baseline;
+	bool loaded = baseline.load(path);
+
+	// A baseline entry for a benchmark which has been removed or has moved
+	// to another line is never compared so warn about it.
+	std::unordered_set<String, StringHash> benchmarkKeys;
+	for (TestCase* tc : tests_) {
+		if (tc->isBenchmark()) {
+			benchmarkKeys.insert(BenchBaseline::key(tc->getTestFilename(), tc->getTestLineNumber()));
+		}
+	}
+	for (const String& k : baseline.getKeys()) {
+		if (benchmarkKeys.count(k) == 0) {
+			scout << "Warning: the benchmark baseline entry for " << k << " matches no benchmark" << sendl;
+		}
+	}
+
+	if (compare) {
+		if (!loaded) {
+			scout << "No benchmark baseline to compare with in " << path.str() << sendl;
+			return;
+		}
+		scout << "===== Comparison with the benchmark baseline =====" << sendl;
+		for (Uint i = 0; i < testIndexes.size(); i++) {
+			TestCase* tc = tests_[testIndexes[i]];
+			const BenchResult& current = tc->getBenchResult();
+			const BenchResult* previous = baseline.find(tc->getTestFilename(), tc->getTestLineNumber());
+			scout << tc->getTestFilename() << "(" << tc->getTestLineNumber() << "): ";
+			if ((previous == nullptr) || current.samples.empty()) {
+				scout << "no comparison" << sendl;
+				continue;
+			}
+
+			// A regression must be both large enough to matter and unlikely
+			// to be due to noise.
+			Float64 change = 100.0 * (current.median - previous->median) / previous->median;
+			Float64 probability = BenchBaseline::slowerProbability(*previous, current);
+			bool regression = (change > (Float64)regressionPercent) && (probability < REGRESSION_SIGNIFICANCE);
+			char buf[200];
+			snprintf(buf, sizeof(buf), "median %.2f -> %.2f ns/op (%+.1f%%, p = %.4f)", 
+				previous->median, current.median, change, probability);
+			scout << String(buf);
+			if (regression) {
+				scout << " REGRESSION";
+				results[i].failureCount++;
+			}
+			scout << sendl;
+		}
+	}
+	if (save) {
+		for (Uint i = 0; i < testIndexes.size(); i++) {
+			TestCase* tc = tests_[testIndexes[i]];
+			if (!tc->getBenchResult().samples.empty()) {
+				baseline.set(tc->getTestFilename(), tc->getTestLineNumber(), tc->getBenchResult());
+			}
+		}
+		baseline.save(path);
+		scout << "The benchmark baseline has been saved to " << path.str() << sendl;
+	}
+}
+
+Uint TestManager::parseCount(const std::string& arg) {
+	if (arg.empty() || (arg.find_first_not_of("0123456789") != std::string::npos) || (arg.size() > 9)) {
+		return INVALID_COUNT;
+	}
+	return (Uint)std::stoul(arg);
+}
+
+bool TestManager::isValueOption(const std::string& name) {
+	return std::find(std::begin(VALUE_OPTIONS), std::end(VALUE_OPTIONS), name) != std::end(VALUE_OPTIONS);
+}
+
+bool TestManager::parseShard(const std::string& arg, Uint& shard, Uint& shardCount) {
+	std::string::size_type slash = arg.find('/');
+	if (slash == std::string::npos) {
+		return false;
+	}
+	Uint i = parseCount(arg.substr(0, slash));
+	Uint n = parseCount(arg.substr(slash + 1));
+	if ((n == INVALID_COUNT) || (i >= n)) {
+		return false;
+	}
+	shard = i;
+	shardCount = n;
+	return true;
+}
+
+std::vector<Uint> TestManager::selectShard(const std::vector<Uint>& testIndexes, Uint shard, Uint shardCount) {
+	std::vector<Uint> ret;
+	for (Uint i = shard; i < testIndexes.size(); i += shardCount) {
+		ret.push_back(testIndexes[i]);
+	}
+	return ret;
+}
+
+std::vector<Uint> TestManager::selectStartAfter(const std::vector<Uint>& testIndexes, Uint startAfter) {
+	std::vector<Uint> ret;
+	for (Uint index : testIndexes) {
+		if (index > startAfter) {
+			ret.push_back(index);
+		}
+	}
+	return ret;
 }
 
 TestManager::TestManager() : 
 	tests_(), 
-	currentTestIndex_(std::numeric_limits<Uint>::max())
+	serialTestCase_(nullptr)
 {
 }
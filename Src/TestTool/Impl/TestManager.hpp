@@ -1,7 +1,11 @@
 #pragma once
 #include <memory>
+#include <string>
 #include <vector>
+#include "Util/Def.hpp"
 
+class FilePath;
+class OutputStream;
 class TestCase;
 DPTR(TestCustomise)
 
@@ -22,13 +26,123 @@ public:
 	// See TestUtil.hpp
 	bool runTests(const char* projectName, int argc, const char** argv, TestCustomisePtr customise);
 
-	// Get the current test case
+	// Get the current test case for the calling thread. Threads started by a
+	// test case when only one job is running also get that test case.
 	TestCase* getTestCase();
 
+	// The result of running a test case
+	struct TestResult {
+		TestResult() : failureCount(0), wallTime(0), cpuTime(0) { }
+		Uint failureCount;		// The number of failures (0 on success)
+		Uint64 wallTime;		// The elapsed time in nanoseconds
+		Uint64 cpuTime;			// The CPU time in nanoseconds (of the thread running the test)
+	};
+
+	// Run the test cases on "jobs" threads (for "--jobs N"). Each test case
+	// has its own virtual file system namespace and its output is captured
+	// and written to "out" in the order of the tests as soon as all the tests
+	// before it have completed. The result for each test is returned in results.
+	static void runParallel(
+		const std::vector<TestCase*>& testCases, 
+		Uint jobs, 
+		TestCustomisePtr customise, 
+		OutputStream& out, 
+		std::vector<TestResult>& results);
+
+	// Get the shard i and the number of shards n from an "i/n" argument (for
+	// "--shard i/n"). Returns false if invalid.
+	static bool parseShard(const std::string& arg, Uint& shard, Uint& shardCount);
+
+	// Returns true if "name" is an option which takes a value, either as
+	// "--name=value" or as the next argument. Any other "--name" argument
+	// is invalid unless it is a flag such as "--bench".
+	static bool isValueOption(const std::string& name);
+
+	// Select one shard of the tests with the given indexes. The shard takes
+	// every shardCount'th test starting with the shard'th. The supervisor
+	// divides the tests between its worker processes in the same way.
+	static std::vector<Uint> selectShard(const std::vector<Uint>& testIndexes, Uint shard, Uint shardCount);
+
+	// Select the tests with indexes into tests_ greater than startAfter (for
+	// "--start-after N" which a restarted worker process uses to continue
+	// after the test which crashed or timed out).
+	static std::vector<Uint> selectStartAfter(const std::vector<Uint>& testIndexes, Uint startAfter);
+
+	// Write the "count" slowest of the test cases (by wall clock time) and
+	// their times to "out" (for "--slowest N"), slowest first. results holds
+	// the result for each test case.
+	static void printSlowest(
+		const std::vector<TestCase*>& testCases, 
+		const std::vector<TestResult>& results, 
+		Uint count, 
+		OutputStream& out);
+
+	// Write the file, line, times and failure count of the test cases to a
+	// JSON file (for "--results FILE"). results holds the result for each
+	// test case.
+	static void writeResults(
+		const FilePath& path, 
+		const std::vector<TestCase*>& testCases, 
+		const std::vector<TestResult>& results);
+
 private:
+	// The default time limit in seconds for a test run by a worker process
+	static const Uint DEFAULT_TIMEOUT = 600;
+
+	// The value returned by parseCount() for an invalid argument
+	static const Uint INVALID_COUNT = (Uint)-1;
+
+	// The default number of slowest tests to display
+	static const Uint DEFAULT_SLOWEST_COUNT = 10;
+
+	// The default percentage increase in the median time of a benchmark over
+	// its baseline which counts as a regression
+	static const Uint DEFAULT_REGRESSION_PERCENT = 10;
+
 	TestManager();
 
+	// Run a single test case on the calling thread with the customisation
+	// actions (if any) before and after. The failures and the time taken
+	// including the customisation actions are returned in result.
+	static void runTest(TestCase* testCase, TestCustomisePtr customise, TestResult& result);
+
+	// Run the tests with the given indexes into tests_ one at a time. The
+	// result for each test is returned in results. If supervised is true then
+	// this is a worker process for runSupervisor().
+	void runSerial(
+		const std::vector<Uint>& testIndexes, 
+		TestCustomisePtr customise, 
+		bool supervised, 
+		std::vector<TestResult>& results);
+
+	// Run the tests with the given indexes into tests_ in "processes" worker
+	// processes which each run one shard of the tests. filterArgs are the
+	// command line arguments which selected the tests. A test which takes
+	// longer than "timeout" seconds (if non-zero) fails.
+	void runSupervisor(
+		const std::vector<Uint>& testIndexes, 
+		const std::vector<std::string>& filterArgs, 
+		Uint processes, 
+		Uint timeout, 
+		std::vector<TestResult>& results);
+
+	// Compare the benchmarks with the given indexes into tests_ with the
+	// baseline in a file and/or save them to it. A benchmark which is
+	// significantly slower than its baseline with a median more than
+	// regressionPercent higher fails.
+	void checkBaseline(
+		const FilePath& path, 
+		const std::vector<Uint>& testIndexes, 
+		bool compare, 
+		bool save, 
+		Uint regressionPercent, 
+		std::vector<TestResult>& results);
+
+	// Get a non-negative number from a command line argument or INVALID_COUNT
+	// if invalid.
+	static Uint parseCount(const std::string& arg);
+
 private:
 	std::vector<TestCase*> tests_;		// The tests
-	Uint currentTestIndex_;				// Index into tests_ for current test when running runTests().
+	TestCase* serialTestCase_;			// The current test when running one job at a time or null.
 };
@@ -0,0 +1,223 @@
+#include "TestTool/Impl/TestProcess.hpp"
+#include "Util/String.hpp"
+#include "Util/Windows.hpp"
+
+#if BUILD(LINUX)
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#if BUILD(WINDOWS)
+	// Append an argument to a Windows command line quoting it so that the
+	// C runtime of the child process splits it back into the same argument.
+	void appendQuoted(std::wstring& commandLine, const std::wstring& arg) {
+		if (!commandLine.empty()) {
+			commandLine += L' ';
+		}
+		commandLine += L'"';
+		Uint backslashes = 0;
+		for (wchar_t ch : arg) {
+			if (ch == L'\\') {
+				backslashes++;
+				continue;
+			}
+			if (ch == L'"') {
+				// Backslashes before a quote and the quote itself are escaped
+				commandLine.append(2 * backslashes + 1, L'\\');
+			}
+			else {
+				commandLine.append(backslashes, L'\\');
+			}
+			backslashes = 0;
+			commandLine += ch;
+		}
+		// Backslashes before the closing quote are escaped
+		commandLine.append(2 * backslashes, L'\\');
+		commandLine += L'"';
+	}
+#endif
+}
+
+TestProcessPtr TestProcess::start(const std::vector<std::string>& args) {
+	TestProcessPtr ret(new TestProcess());
+#if BUILD(WINDOWS)
+	wchar_t exePath[MAX_PATH];
+	DWORD exePathLen = GetModuleFileNameW(NULL, exePath, MAX_PATH);
+	if ((exePathLen == 0) || (exePathLen == MAX_PATH)) {
+		return TestProcessPtr();
+	}
+	std::wstring commandLine;
+	appendQuoted(commandLine, exePath);
+	for (const std::string& arg : args) {
+		appendQuoted(commandLine, String(arg).toPlatform());
+	}
+
+	// The write end of the pipe is inherited by the child as its standard output
+	SECURITY_ATTRIBUTES sa;
+	sa.nLength = sizeof(sa);
+	sa.lpSecurityDescriptor = NULL;
+	sa.bInheritHandle = TRUE;
+	HANDLE readPipe;
+	HANDLE writePipe;
+	if (!CreatePipe(&readPipe, &writePipe, &sa, 0)) {
+		return TestProcessPtr();
+	}
+	SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOW si;
+	ZeroMemory(&si, sizeof(si));
+	si.cb = sizeof(si);
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	si.hStdOutput = writePipe;
+	si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION pi;
+	BOOL status = CreateProcessW(exePath, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+	CloseHandle(writePipe);
+	if (!status) {
+		CloseHandle(readPipe);
+		return TestProcessPtr();
+	}
+	CloseHandle(pi.hThread);
+	ret->process_ = pi.hProcess;
+	ret->outputPipe_ = readPipe;
+#elif BUILD(LINUX)
+	char exePath[PATH_MAX];
+	ssize_t exePathLen = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+	if (exePathLen <= 0) {
+		return TestProcessPtr();
+	}
+	exePath[exePathLen] = '\0';
+
+	// Build the argument list before forking since only async signal safe
+	// functions may be called in the child before exec.
+	std::vector<char*> argv;
+	argv.push_back(exePath);
+	for (const std::string& arg : args) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	int fds[2];
+	if (pipe2(fds, O_CLOEXEC) != 0) {
+		return TestProcessPtr();
+	}
+	pid_t pid = fork();
+	if (pid == 0) {
+		// Child
+		dup2(fds[1], STDOUT_FILENO);
+		execv(exePath, argv.data());
+		_exit(127);
+	}
+	close(fds[1]);
+	if (pid < 0) {
+		close(fds[0]);
+		return TestProcessPtr();
+	}
+	ret->pid_ = (int)pid;
+	ret->outputPipe_ = fds[0];
+#else
+#error "Illegal build"
+#endif
+	ret->reader_ = std::thread(&TestProcess::readOutput, ret.get());
+	return ret;
+}
+
+TestProcess::~TestProcess() {
+	bool closed;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed = closed_;
+	}
+	if (!closed) {
+		kill();
+	}
+	if (reader_.joinable()) {
+		reader_.join();
+	}
+#if BUILD(WINDOWS)
+	if (process_ != NULL) {
+		WaitForSingleObject(process_, INFINITE);
+		CloseHandle(process_);
+	}
+	if (outputPipe_ != NULL) {
+		CloseHandle(outputPipe_);
+	}
+#elif BUILD(LINUX)
+	if (pid_ > 0) {
+		int status;
+		waitpid((pid_t)pid_, &status, 0);
+	}
+	if (outputPipe_ >= 0) {
+		close(outputPipe_);
+	}
+#else
+#error "Illegal build"
+#endif
+}
+
+bool TestProcess::read(std::string& output) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	output += output_;
+	output_.clear();
+	return !closed_;
+}
+
+void TestProcess::kill() {
+#if BUILD(WINDOWS)
+	TerminateProcess(process_, 1);
+#elif BUILD(LINUX)
+	::kill((pid_t)pid_, SIGKILL);
+#else
+#error "Illegal build"
+#endif
+}
+
+TestProcess::TestProcess() :
+#if BUILD(WINDOWS)
+	process_(NULL),
+	outputPipe_(NULL),
+#elif BUILD(LINUX)
+	pid_(-1),
+	outputPipe_(-1),
+#else
+#error "Illegal build"
+#endif
+	reader_(),
+	mutex_(),
+	output_(),
+	closed_(false)
+{
+}
+
+void TestProcess::readOutput() {
+	char buf[4096];
+	for (;;) {
+#if BUILD(WINDOWS)
+		DWORD len = 0;
+		if (!ReadFile(outputPipe_, buf, sizeof(buf), &len, NULL) || (len == 0)) {
+			break;
+		}
+#elif BUILD(LINUX)
+		ssize_t len = ::read(outputPipe_, buf, sizeof(buf));
+		if ((len < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (len <= 0) {
+			break;
+		}
+#else
+#error "Illegal build"
+#endif
+		std::lock_guard<std::mutex> lock(mutex_);
+		output_.append(buf, (size_t)len);
+	}
+	std::lock_guard<std::mutex> lock(mutex_);
+	closed_ = true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Util/Def.hpp"
+
+DPTR(TestProcess)
+
+// A child process running another copy of the current test executable. Its
+// standard output is read through a pipe by a background thread so that the
+// parent can poll it without blocking. The standard error is shared with the
+// parent.
+class TestProcess {
+public:
+	// Start a copy of the current executable with the given command line
+	// arguments (not including the executable name). Returns null if the
+	// process cannot be started.
+	static TestProcessPtr start(const std::vector<std::string>& args);
+
+	// Destructor. Kills the process if it is still running and waits for it.
+	~TestProcess();
+
+	// Append any output received since the last call to "output". Returns
+	// false if the process has closed its output (normally because it has
+	// exited) and there will be no more.
+	bool read(std::string& output);
+
+	// Kill the process.
+	void kill();
+
+private:
+	TestProcess();
+
+	// The background thread function which reads the output.
+	void readOutput();
+
+private:
+#if BUILD(WINDOWS)
+	void* process_;			// The process handle
+	void* outputPipe_;		// The read end of the output pipe
+#elif BUILD(LINUX)
+	int pid_;				// The process ID
+	int outputPipe_;		// The read end of the output pipe
+#else
+#error "Illegal build"
+#endif
+	std::thread reader_;	// The thread reading the output
+	std::mutex mutex_;		// Protects the following
+	std::string output_;	// Output not yet returned by read()
+	bool closed_;			// True once the output has been closed
+};
@@ -0,0 +1,34 @@
+#include "TestTool/ToolArgs.hpp"
+#include "Util/String.hpp"
+#include "Util/WorkStealingPool.hpp"
+
+namespace ToolArgs {
+
+	Uint parseThreadCount(const std::string& arg) {
+		if (arg.empty() || (arg.find_first_not_of("0123456789") != std::string::npos) || (arg.size() > 4)) {
+			throw String("invalid thread count for -j");
+		}
+		Uint ret = (Uint)std::stoul(arg);
+		if (ret == 0) {
+			throw String("invalid thread count for -j");
+		}
+		return ret;
+	}
+
+	Uint threadCountFromArgs(int argc, const char* const* argv, const char* usage) {
+		Uint threadCount = WorkStealingPool::defaultThreadCount();
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if ((arg == "-j") && (i + 1 < argc)) {
+				threadCount = parseThreadCount(argv[++i]);
+			}
+			else if ((arg.size() > 2) && (arg.compare(0, 2, "-j") == 0)) {
+				threadCount = parseThreadCount(arg.substr(2));
+			}
+			else {
+				throw String(usage);
+			}
+		}
+		return threadCount;
+	}
+}
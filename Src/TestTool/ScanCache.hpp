@@ -0,0 +1,54 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "Util/Def.hpp"
+
+class FilePath;
+
+// The results of scanning source files (the lines found in each file) kept
+// in a cache file between runs of a tool such as AssertHashMap. A file only
+// needs to be rescanned if its size or modification time (see
+// FilePath::getStatus()) has changed. Files are identified by a key such as
+// their path relative to the Src directory.
+class ScanCache {
+public:
+	// Construct an empty cache.
+	ScanCache();
+
+	// Load a cache file. Returns an empty cache if there is no cache file or
+	// if it is out of date or damaged.
+	static ScanCache load(const FilePath& cacheFile);
+
+	// Save the cache to a file.
+	void save(const FilePath& cacheFile) const;
+
+	// Get the lines of the file with the given key if the cache has them for
+	// the same size and modification time. Returns false if the file is not
+	// in the cache or has changed.
+	bool find(const std::string& key, Uint64 size, Int64 modifiedTime, std::vector<int>& lines) const;
+
+	// Set the lines of the file with the given key for its size and
+	// modification time.
+	void set(const std::string& key, Uint64 size, Int64 modifiedTime, const std::vector<int>& lines);
+
+	// Add the files from another cache.
+	void merge(const ScanCache& other);
+
+	// Test whether the cache has the file with the given key.
+	bool contains(const std::string& key) const;
+
+	// Get the keys of all the files in the cache.
+	std::vector<std::string> keys() const;
+
+private:
+	// The scan results for a file
+	struct Entry {
+		Entry() : size(0), modifiedTime(0), lines() { }
+		Uint64 size;
+		Int64 modifiedTime;
+		std::vector<int> lines;
+	};
+
+	std::map<std::string, Entry> entries_;		// The entries by key
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <chrono>
+#include "TestTool/TestUtil.hpp"
+#include "Util/Def.hpp"
+
+#if BUILD(MSV)
+#include <intrin.h>
+#endif
+
+// Benchmark header file. Include this file in any file with benchmarks.
+//
+// Typical benchmark usage is:
+//
+//		AUTO_BENCHMARK {
+//			... set up (not timed)
+//			while (state.keepRunning()) {
+//				doNotOptimize(... the code to time ...);
+//			}
+//			state.setBytesPerIteration(...);	// Optional
+//		}
+//
+// The AUTO_BENCHMARK line of the above (assuming it was on line 123 of file "myfile") expands to:
+//
+//		static void benchmarkAtLine123(BenchState& state);
+//		static TestUtil::BenchmarkRegistrar benchmarkRegistrationAtLine123("myfile", 123, benchmarkAtLine123);
+//		static void benchmarkAtLine123(BenchState& state) {
+//
+// Benchmarks are registered in the same way as tests but are only run when
+// the test executable is given the "--bench" argument (see TestUtil::runTests()).
+// The test macros such as CHECK can be used in a benchmark.
+//
+// The benchmark function is called many times. The first calls find the number
+// of iterations needed for a repetition to take at least the minimum time. Then
+// there are the warmup repetitions and then the timed repetitions. The mean,
+// median and standard deviation of the time per iteration over the timed
+// repetitions is reported along with the throughput if the benchmark sets the
+// number of bytes per iteration.
+
+// Macro to start a benchmark. The function body has a BenchState& argument
+// named "state".
+#define AUTO_BENCHMARK \
+	static void DELAYED_PASTE1(benchmarkAtLine, __LINE__)(BenchState& state); \
+	static TestUtil::BenchmarkRegistrar DELAYED_PASTE1(benchmarkRegistrationAtLine, __LINE__) (__FILE__, __LINE__, DELAYED_PASTE1(benchmarkAtLine, __LINE__)); \
+	static void DELAYED_PASTE1(benchmarkAtLine, __LINE__)(BenchState& state)
+
+// The state of a benchmark which is passed to each call of the benchmark
+// function. It runs the timed loop and holds the settings for the benchmark.
+class BenchState {
+public:
+	// Default settings
+	static const Uint DEFAULT_REPETITIONS = 10;
+	static const Uint DEFAULT_WARMUP_REPETITIONS = 1;
+	static const Uint DEFAULT_MIN_TIME_MS = 20;
+
+	// Constructor
+	BenchState();
+
+	// Returns true while there are iterations left to run. The timer starts
+	// on the first call and stops when this returns false. So this should be
+	// the condition of the loop around the code being timed.
+	bool keepRunning() {
+		if (remaining_ == 0) {
+			stopTimer();
+			return false;
+		}
+		if (!started_) {
+			startTimer();
+		}
+		--remaining_;
+		return true;
+	}
+
+	// Pause and resume the timer for work inside the loop which is not
+	// part of the benchmark.
+	void pauseTiming();
+	void resumeTiming();
+
+	// Get the number of iterations in the current call.
+	Uint64 getIterations() const { return iterations_; }
+
+	// Set the number of bytes processed by each iteration so that the
+	// throughput can be reported.
+	void setBytesPerIteration(Uint64 bytes) { bytesPerIteration_ = bytes; }
+
+	// Change the settings. These take effect from the next call of the
+	// benchmark function so they should be set at the start of the function.
+	// Setting a fixed number of iterations (non-zero) disables the search for
+	// the number of iterations needed to run for the minimum time.
+	void setRepetitions(Uint repetitions) { repetitions_ = repetitions; }
+	void setWarmupRepetitions(Uint warmupRepetitions) { warmupRepetitions_ = warmupRepetitions; }
+	void setMinTime(Uint milliseconds) { minTimeMs_ = milliseconds; }
+	void setIterations(Uint64 iterations) { fixedIterations_ = iterations; }
+
+private:
+	friend class BenchRunner;
+
+	// Start and stop the timer
+	void startTimer();
+	void stopTimer();
+
+private:
+	Uint64 iterations_;				// The number of iterations for the current call
+	Uint64 remaining_;				// The number of iterations still to run
+	bool started_;					// True once the timer has been started for the current call
+	bool running_;					// True while the timer is running
+	std::chrono::steady_clock::time_point startTime_;	// When the timer was last started
+	std::chrono::steady_clock::duration elapsed_;		// The time accumulated while running
+	Uint64 bytesPerIteration_;		// Bytes per iteration or 0 if not set
+	Uint repetitions_;				// The number of timed repetitions
+	Uint warmupRepetitions_;		// The number of repetitions before the timed ones
+	Uint minTimeMs_;				// The minimum time for a repetition in milliseconds
+	Uint64 fixedIterations_;		// The number of iterations for each repetition or 0
+};
+
+// Prevent the compiler from optimising away the calculation of "value"
+// even if the result is not used.
+template<class T> inline void doNotOptimize(const T& value) {
+#if BUILD(MSV)
+	static const volatile char* volatile sink;
+	sink = reinterpret_cast<const volatile char*>(&value);
+	_ReadWriteBarrier();
+#elif BUILD(GNU)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+#error "Illegal build"
+#endif
+}
+
+// Prevent the compiler from assuming anything about memory so that all
+// pending writes are done.
+inline void clobberMemory() {
+#if BUILD(MSV)
+	_ReadWriteBarrier();
+#elif BUILD(GNU)
+	asm volatile("" : : : "memory");
+#else
+#error "Illegal build"
+#endif
+}
+
+namespace TestUtil {
+
+	// A simple registrar class which constructs and registers a benchmark.
+	class BenchmarkRegistrar {
+	public:
+		// file: The source file containing the benchmark
+		// line: The source line the benchmark starts at
+		// benchFunc: The benchmark function to run
+		BenchmarkRegistrar(const char* file, int line, BenchFunc benchFunc);
+	};
+
+}
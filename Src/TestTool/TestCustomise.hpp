@@ -16,10 +16,12 @@ public:
 	// Action to perform once after running all test cases
 	virtual void afterAllTests() = 0;
 
-	// Action to perform before running each test case
+	// Action to perform before running each test case. With more than one
+	// job this is called concurrently by the threads running the test cases.
 	virtual void beforeTestCase() = 0;
 
-	// Action to perform after running each test case
+	// Action to perform after running each test case. With more than one
+	// job this is called concurrently by the threads running the test cases.
 	virtual void afterTestCase() = 0;
 };
 DPTR(TestCustomise)
@@ -56,6 +56,7 @@
 #define CHECK_EQUAL(x, y)   do { if (!((x) == (y))) TestUtil::testFailure(__FILE__, __LINE__, #x, #y, (x), (y), false); } while (false)
 #define REQUIRE_EQUAL(x, y) do { if (!((x) == (y))) TestUtil::testFailure(__FILE__, __LINE__, #x, #y, (x), (y), true ); } while (false)
 
+class BenchState;
 DPTR(TestCustomise)
 
 namespace TestUtil {
@@ -63,6 +64,9 @@ namespace TestUtil {
 	// The function type for the test function.
 	typedef void (*TestFunc)();
 
+	// The function type for the benchmark function (see TestBenchmark.hpp).
+	typedef void (*BenchFunc)(BenchState& state);
+
 	// A simple registrar class which constructs and registers a test.
 	class TestRegistrar {
 	public:
@@ -124,9 +128,60 @@ namespace TestUtil {
 	// including the Src directory with optionally a test line number in brackets.
 	// If the line number is omitted all tests in that file are run.
 	//
+	// The argument "--jobs N" (or "--jobs=N") runs N test cases at a time on
+	// separate threads. The output of each test case is buffered and output in
+	// the same order as for a single job. Test cases run this way must not
+	// depend on shared state which is not thread safe and any threads they
+	// start themselves cannot use the test macros (which they can with a
+	// single job). Each has its own virtual file system (see
+	// FileSystem::setVirtualNamespace()) although threads it starts use the
+	// default one.
+	//
+	// The argument "--shard i/n" runs only every n'th selected test starting
+	// with the i'th (counting from 0) so that a large suite can be split
+	// between runs. The argument "--processes N" runs the selected tests in N
+	// worker processes, each running one shard. A test which crashes its
+	// worker or runs for longer than the "--timeout S" seconds (default 600,
+	// 0 for no limit) fails and a new worker continues with the rest of the
+	// shard. The output is the same as for a single process.
+	//
+	// Tests run one at a time (the default, and in each worker process) do
+	// not share the virtual file system or the file system error handler.
+	// After each test and its customisation actions, the virtual file system
+	// is stopped and the file system error handler is set back to the one in
+	// use when the tests started (after the customisation action before all
+	// tests). So a failing test cannot leave them changed for later tests,
+	// and a test cannot rely on a virtual file system started or an error
+	// handler set by an earlier test.
+	//
+	// The wall clock and CPU time of each test (including the customisation
+	// actions before and after it) are measured. The "--slowest N" slowest
+	// tests (default 10, 0 for none) are listed at the end. The argument
+	// "--results FILE" writes the file, line, times and failure count of
+	// every test run to FILE in JSON.
+	//
+	// The argument "--bench" runs the benchmarks (see TestBenchmark.hpp)
+	// instead of the tests. "--bench=TEXT" runs only the benchmarks whose
+	// "file(line)" contains TEXT ignoring case. The other arguments select
+	// benchmarks in the same way as tests but benchmarks are always run one
+	// at a time in this process.
+	//
+	// With "--bench" the argument "--baseline save" saves the benchmark
+	// results to "benchmarks.csv" in the project test directory (replacing
+	// the results of the same benchmarks from earlier runs). The argument
+	// "--baseline compare" compares the results with this file instead. A
+	// benchmark fails if its median time is more than the "--regression P"
+	// percentage (default 10) higher than its baseline and a one sided
+	// Mann-Whitney U test finds it slower at the 1% significance level. So
+	// noise alone should not cause a failure.
+	//
 	// "customise" set the actions to perform at different points
 	// during the testing. Setting null (the default) disables all
-	// actions.
+	// actions. With more than one job the actions before and after each test
+	// case are called on the thread running the test case, so they may be
+	// called concurrently and must be thread safe. The file system error
+	// handler is likewise shared by the test cases running at the same time
+	// and a test case which sets it should not be run with other jobs.
 	bool runTests(const char* projectName, int argc, const char** argv, TestCustomisePtr customise = TestCustomisePtr());
 }
 
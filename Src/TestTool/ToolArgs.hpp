@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include "Util/Def.hpp"
+
+// Command line argument handling shared by the tools which are built with
+// the test tool (AssertHashMap, CheckLineEndings).
+namespace ToolArgs {
+	// Get the thread count from the N of a -j N command line argument which
+	// must be a number from 1 to 9999. Throws a String if it is not.
+	Uint parseThreadCount(const std::string& arg);
+
+	// Get the thread count from the command line of a tool whose only
+	// argument is an optional -j N or -jN. Returns the default thread count
+	// (see WorkStealingPool::defaultThreadCount()) if there is no -j
+	// argument. Throws a String if the thread count is not valid or, with
+	// usage as its text, if there are any other arguments.
+	Uint threadCountFromArgs(int argc, const char* const* argv, const char* usage);
+}
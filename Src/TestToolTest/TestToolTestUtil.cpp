@@ -1,7 +1,21 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include "TestTool/Impl/BenchBaseline.hpp"
+#include "TestTool/Impl/BenchRunner.hpp"
+#include "TestTool/Impl/TestCase.hpp"
+#include "TestTool/Impl/TestManager.hpp"
+#include "TestTool/ScanCache.hpp"
+#include "TestTool/TestFile.hpp"
 #include "TestTool/TestEvent.hpp"
 #include "TestTool/TestUtil.hpp"
+#include "TestTool/ToolArgs.hpp"
 #include "Util/Def.hpp"
+#include "Util/File.hpp"
+#include "Util/WorkStealingPool.hpp"
 
 class LocalTestEvent : public TestEvent {
 public:
@@ -79,3 +93,345 @@ AUTO_TEST_CASE {
 	// REQUIRE(1 == 2);
 	// REQUIRE_EQUAL(1, 2);
 }
+
+// Benchmark statistics
+AUTO_TEST_CASE {
+	BenchResult result;
+	result.samples = { 5.0, 1.0, 4.0, 2.0, 3.0 };
+	BenchRunner::calculate(result);
+	CHECK(result.mean == 3.0);
+	CHECK(result.median == 3.0);
+	CHECK(std::fabs(result.stddev - std::sqrt(2.5)) < 1e-9);
+
+	result.samples = { 4.0, 1.0, 2.0, 10.0 };
+	BenchRunner::calculate(result);
+	CHECK(result.mean == 4.25);
+	CHECK(result.median == 3.0);
+
+	result.samples = { 7.0 };
+	BenchRunner::calculate(result);
+	CHECK(result.median == 7.0);
+	CHECK(result.stddev == 0.0);
+}
+
+// Benchmark baseline comparison
+AUTO_TEST_CASE {
+	BenchResult baseline;
+	BenchResult same;
+	BenchResult slower;
+	BenchResult noisy;
+	for (Uint i = 0; i < 10; i++) {
+		baseline.samples.push_back(100.0 + i);
+		same.samples.push_back(100.5 + i);
+		slower.samples.push_back(120.0 + i);
+		noisy.samples.push_back((i % 2 == 0) ? 90.0 + i : 130.0 + i);
+	}
+	CHECK(BenchBaseline::slowerProbability(baseline, slower) < 0.001);
+	CHECK(BenchBaseline::slowerProbability(baseline, same) > 0.1);
+	CHECK(BenchBaseline::slowerProbability(baseline, noisy) > 0.01);
+	CHECK(BenchBaseline::slowerProbability(slower, baseline) > 0.99);
+	CHECK(BenchBaseline::slowerProbability(baseline, BenchResult()) == 1.0);
+
+	// Save and load
+	FileSystem::startVirtualFileSystem();
+	FilePath path = TestFile::getTestFile("TestToolTest/$benchmarks.csv");
+	BenchBaseline saved;
+	CHECK(!saved.load(path));
+	slower.iterations = 1000;
+	slower.bytesPerIteration = 64;
+	saved.set("src/testtooltest/a,b.cpp", 12, slower);
+	saved.set("src/testtooltest/c.cpp", 34, baseline);
+	saved.save(path);
+
+	BenchBaseline loaded;
+	CHECK(loaded.load(path));
+	const BenchResult* r = loaded.find("src/testtooltest/a,b.cpp", 12);
+	REQUIRE(r != nullptr);
+	CHECK(r->samples == slower.samples);
+	CHECK(r->iterations == 1000);
+	CHECK(r->bytesPerIteration == 64);
+	CHECK(r->median == 124.5);
+	CHECK(loaded.find("src/testtooltest/c.cpp", 34) != nullptr);
+	CHECK(loaded.find("src/testtooltest/c.cpp", 35) == nullptr);
+	CHECK(loaded.getKeys() == std::vector<String>({ "src/testtooltest/a,b.cpp(12)", "src/testtooltest/c.cpp(34)" }));
+	CHECK(BenchBaseline::key("src/testtooltest/c.cpp", 34) == "src/testtooltest/c.cpp(34)");
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test cases run in parallel by the following test. Each outputs its number
+// and fails a number of times. The earlier ones take longer so that they
+// complete out of order.
+static void parallelTest(Uint n, Uint failures) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10 * (4 - n)));
+	scout << "Parallel test " << n << sendl;
+	for (Uint i = 0; i < failures; i++) {
+		CHECK(false);
+	}
+}
+static void parallelTest0() { parallelTest(0, 0); }
+static void parallelTest1() { parallelTest(1, 2); }
+static void parallelTest2() { parallelTest(2, 0); }
+static void parallelTest3() { parallelTest(3, 1); }
+
+// Running test cases in parallel (as for "--jobs N")
+AUTO_TEST_CASE {
+	TestCase test0(__FILE__, 1000, &parallelTest0);
+	TestCase test1(__FILE__, 1001, &parallelTest1);
+	TestCase test2(__FILE__, 1002, &parallelTest2);
+	TestCase test3(__FILE__, 1003, &parallelTest3);
+	std::vector<TestCase*> testCases = { &test0, &test1, &test2, &test3 };
+	String output;
+	std::vector<TestManager::TestResult> results;
+	TestManager::runParallel(testCases, 4, TestCustomisePtr(), output, results);
+
+	// Each test has its own failure count
+	REQUIRE(results.size() == 4);
+	CHECK(results[0].failureCount == 0);
+	CHECK(results[1].failureCount == 2);
+	CHECK(results[2].failureCount == 0);
+	CHECK(results[3].failureCount == 1);
+
+	// The output of each test is complete and in the test order
+	std::string text = output.toUtf8();
+	std::string::size_type pos = 0;
+	for (int n = 0; n < 4; n++) {
+		std::ostringstream header;
+		header << "===== src/testtooltest/testtooltestutil.cpp(" << 1000 + n << ") =====";
+		std::string::size_type headerPos = text.find(header.str());
+		REQUIRE(headerPos == pos);
+		pos = text.find("Parallel test " + std::to_string(n), headerPos);
+		REQUIRE(pos != std::string::npos);
+		std::string::size_type next = text.find("=====", pos);
+		Uint errors = 0;
+		for (std::string::size_type error = text.find("TEST ERROR", pos); error < next; error = text.find("TEST ERROR", error + 1)) {
+			errors++;
+		}
+		CHECK(errors == results[n].failureCount);
+		pos = (next == std::string::npos) ? text.size() : next;
+	}
+	CHECK(pos == text.size());
+}
+
+// Parsing the "--shard i/n" argument
+AUTO_TEST_CASE {
+	Uint shard = 7;
+	Uint shardCount = 9;
+	CHECK(TestManager::parseShard("1/3", shard, shardCount));
+	CHECK((shard == 1) && (shardCount == 3));
+	CHECK(TestManager::parseShard("0/1", shard, shardCount));
+	CHECK((shard == 0) && (shardCount == 1));
+	const char* const invalid[] = { "", "1", "/3", "1/", "3/3", "0/0", "-1/3", "1/3x", "a/b" };
+	for (const char* arg : invalid) {
+		CHECK(!TestManager::parseShard(arg, shard, shardCount));
+	}
+	CHECK((shard == 0) && (shardCount == 1));
+}
+
+// Only the options which take a value take the next argument as it
+AUTO_TEST_CASE {
+	CHECK(TestManager::isValueOption("--jobs"));
+	CHECK(TestManager::isValueOption("--shard"));
+	CHECK(TestManager::isValueOption("--results"));
+	CHECK(!TestManager::isValueOption("--job"));
+	CHECK(!TestManager::isValueOption("--jobs=2"));
+	CHECK(!TestManager::isValueOption("--unknown"));
+}
+
+// Selecting a shard of the tests and then the tests after a given index as
+// a restarted worker process does
+AUTO_TEST_CASE {
+	const std::vector<Uint> indexes = { 2, 3, 5, 8, 13, 21, 34 };
+	CHECK(TestManager::selectShard(indexes, 0, 1) == indexes);
+	CHECK(TestManager::selectShard(indexes, 0, 3) == std::vector<Uint>({ 2, 8, 34 }));
+	CHECK(TestManager::selectShard(indexes, 1, 3) == std::vector<Uint>({ 3, 13 }));
+	CHECK(TestManager::selectShard(indexes, 2, 3) == std::vector<Uint>({ 5, 21 }));
+	CHECK(TestManager::selectShard(indexes, 7, 8).empty());
+	CHECK(TestManager::selectShard(std::vector<Uint>(), 0, 2).empty());
+
+	// Every test is in exactly one shard
+	for (Uint shardCount = 1; shardCount <= 9; shardCount++) {
+		std::vector<Uint> all;
+		for (Uint shard = 0; shard < shardCount; shard++) {
+			std::vector<Uint> selected = TestManager::selectShard(indexes, shard, shardCount);
+			all.insert(all.end(), selected.begin(), selected.end());
+		}
+		std::sort(all.begin(), all.end());
+		CHECK(all == indexes);
+	}
+
+	std::vector<Uint> shard = TestManager::selectShard(indexes, 0, 3);
+	CHECK(TestManager::selectStartAfter(shard, 0) == shard);
+	CHECK(TestManager::selectStartAfter(shard, 2) == std::vector<Uint>({ 8, 34 }));
+	CHECK(TestManager::selectStartAfter(shard, 7) == std::vector<Uint>({ 8, 34 }));
+	CHECK(TestManager::selectStartAfter(shard, 34).empty());
+}
+
+// Test cases for the following tests which are never run
+static void unusedTest() { }
+
+// Listing the slowest tests (for "--slowest N")
+AUTO_TEST_CASE {
+	TestCase test0(__FILE__, 1000, &unusedTest);
+	TestCase test1(__FILE__, 1001, &unusedTest);
+	TestCase test2(__FILE__, 1002, &unusedTest);
+	TestCase test3(__FILE__, 1003, &unusedTest);
+	std::vector<TestCase*> testCases = { &test0, &test1, &test2, &test3 };
+	std::vector<TestManager::TestResult> results(4);
+	const Uint64 wallTimes[] = { 3000000, 1000000, 5000000, 2000000 };
+	for (Uint i = 0; i < 4; i++) {
+		results[i].wallTime = wallTimes[i];
+		results[i].cpuTime = wallTimes[i] / 10;
+	}
+
+	String output;
+	TestManager::printSlowest(testCases, results, 2, output);
+	CHECK(output == 
+		"===== The 2 slowest tests =====\n"
+		"src/testtooltest/testtooltestutil.cpp(1002): 5.000 ms (CPU 0.500 ms)\n"
+		"src/testtooltest/testtooltestutil.cpp(1000): 3.000 ms (CPU 0.300 ms)\n");
+
+	// All the tests are listed if there are fewer than the count
+	output = String();
+	TestManager::printSlowest(testCases, results, 10, output);
+	std::string text = output.toUtf8();
+	std::string heading = "===== The 4 slowest tests =====\n";
+	CHECK(text.compare(0, heading.size(), heading) == 0);
+	std::string::size_type pos0 = text.find("(1000)");
+	std::string::size_type pos1 = text.find("(1001)");
+	std::string::size_type pos2 = text.find("(1002)");
+	std::string::size_type pos3 = text.find("(1003)");
+	CHECK((pos2 < pos0) && (pos0 < pos3) && (pos3 < pos1) && (pos1 != std::string::npos));
+
+	output = String();
+	TestManager::printSlowest(testCases, results, 0, output);
+	CHECK(output.empty());
+}
+
+// Writing the results as JSON (for "--results FILE")
+AUTO_TEST_CASE {
+	// A file name with a quote and a control character which must be escaped
+	String separator = FileSystem::getPathSeparator();
+	std::string oddFile = (String("c:") + separator + "work" + separator + "src" + separator + 
+		"dir" + separator + "a\"b\tc.cpp").toUtf8();
+	TestCase test0(__FILE__, 1000, &unusedTest);
+	TestCase test1(oddFile.c_str(), 7, &unusedTest);
+	std::vector<TestCase*> testCases = { &test0, &test1 };
+	std::vector<TestManager::TestResult> results(2);
+	results[0].wallTime = 1234567;
+	results[0].cpuTime = 1000000;
+	results[1].wallTime = 89;
+	results[1].cpuTime = 0;
+	results[1].failureCount = 3;
+
+	FileSystem::startVirtualFileSystem();
+	FilePath path = TestFile::getTestFile("TestToolTest/$results.json");
+	TestManager::writeResults(path, testCases, results);
+	std::string json = FileBinaryInput::open(path)->readString();
+	CHECK(json == 
+		"{\n"
+		"\t\"tests\": [\n"
+		"\t\t{ \"file\": \"src/testtooltest/testtooltestutil.cpp\", \"line\": 1000, "
+		"\"wallNs\": 1234567, \"cpuNs\": 1000000, \"failures\": 0 },\n"
+		"\t\t{ \"file\": \"src/dir/a\\\"b\\u0009c.cpp\", \"line\": 7, "
+		"\"wallNs\": 89, \"cpuNs\": 0, \"failures\": 3 }\n"
+		"\t]\n"
+		"}\n");
+
+	// No tests
+	TestManager::writeResults(path, std::vector<TestCase*>(), std::vector<TestManager::TestResult>());
+	CHECK(FileBinaryInput::open(path)->readString() == "{\n\t\"tests\": [\n\t]\n}\n");
+	FileSystem::stopVirtualFileSystem();
+}
+
+// The -j command line argument of the tools
+AUTO_TEST_CASE {
+	const char* noArgs[] = { "Tool.exe" };
+	CHECK(ToolArgs::threadCountFromArgs(1, noArgs, "usage") == WorkStealingPool::defaultThreadCount());
+	const char* separate[] = { "Tool.exe", "-j", "3" };
+	CHECK(ToolArgs::threadCountFromArgs(3, separate, "usage") == 3);
+	const char* joined[] = { "Tool.exe", "-j12" };
+	CHECK(ToolArgs::threadCountFromArgs(2, joined, "usage") == 12);
+	const char* last[] = { "Tool.exe", "-j2", "-j", "5" };
+	CHECK(ToolArgs::threadCountFromArgs(4, last, "usage") == 5);
+
+	const char* const invalidCounts[] = { "", "0", "-1", "1x", "10000" };
+	for (const char* count : invalidCounts) {
+		const char* args[] = { "Tool.exe", "-j", count };
+		bool caught = false;
+		try {
+			ToolArgs::threadCountFromArgs(3, args, "usage");
+		}
+		catch (String& ex) {
+			caught = (ex == "invalid thread count for -j");
+		}
+		CHECK(caught);
+	}
+
+	const char* const otherArgs[] = { "-x", "-j", "j4" };
+	for (const char* arg : otherArgs) {
+		const char* args[] = { "Tool.exe", arg };
+		bool caught = false;
+		try {
+			ToolArgs::threadCountFromArgs(2, args, "usage");
+		}
+		catch (String& ex) {
+			caught = (ex == "usage");
+		}
+		CHECK(caught);
+	}
+}
+
+// The scan cache used by AssertHashMap
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	FilePath source = TestFile::createBinaryTestFile("TestToolTest/$source.cpp", "ASSERT(true);");
+	FilePath cacheFile = TestFile::getTestFile("TestToolTest/$cache.bin");
+	Uint64 size;
+	Int64 modifiedTime;
+	REQUIRE(source.getStatus(size, modifiedTime));
+
+	// No cache file
+	ScanCache cache = ScanCache::load(cacheFile);
+	std::vector<int> lines;
+	CHECK(!cache.find("source.cpp", size, modifiedTime, lines));
+	CHECK(cache.keys().empty());
+
+	// A hit after saving and loading
+	cache.set("source.cpp", size, modifiedTime, { 1, 7 });
+	cache.set("other.cpp", 5, 6, std::vector<int>());
+	cache.save(cacheFile);
+	ScanCache loaded = ScanCache::load(cacheFile);
+	CHECK(loaded.keys() == std::vector<std::string>({ "other.cpp", "source.cpp" }));
+	CHECK(loaded.find("source.cpp", size, modifiedTime, lines));
+	CHECK(lines == std::vector<int>({ 1, 7 }));
+	CHECK(loaded.find("other.cpp", 5, 6, lines));
+	CHECK(lines.empty());
+
+	// Changing the file invalidates its entry
+	TestFile::createBinaryTestFile(source, "ASSERT(true);");
+	Uint64 newSize;
+	Int64 newModifiedTime;
+	REQUIRE(source.getStatus(newSize, newModifiedTime));
+	CHECK(newModifiedTime != modifiedTime);
+	CHECK(!loaded.find("source.cpp", newSize, newModifiedTime, lines));
+	CHECK(!loaded.find("source.cpp", size + 1, modifiedTime, lines));
+	CHECK(loaded.contains("source.cpp"));
+	CHECK(!loaded.contains("missing.cpp"));
+
+	// Merging keeps the entries of both caches
+	ScanCache merged;
+	ScanCache part;
+	part.set("a.cpp", 1, 2, { 3 });
+	merged.merge(part);
+	merged.merge(loaded);
+	CHECK(merged.keys() == std::vector<std::string>({ "a.cpp", "other.cpp", "source.cpp" }));
+
+	// A damaged or out of date cache file is ignored
+	std::string data = TestFile::readBinaryFile(cacheFile);
+	TestFile::createBinaryTestFile(cacheFile, data.substr(0, data.size() - 1));
+	CHECK(ScanCache::load(cacheFile).keys().empty());
+	data[4]++;
+	TestFile::createBinaryTestFile(cacheFile, data);
+	CHECK(ScanCache::load(cacheFile).keys().empty());
+	FileSystem::stopVirtualFileSystem();
+}
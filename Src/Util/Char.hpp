@@ -1,65 +1,114 @@
 #pragma once
+#include "Util/Assert.hpp"
 #include "Util/Def.hpp"
 
+// The properties of the characters in the Basic Multilingual Plane (U+0000
+// to U+FFFF) used by the inline Char classification functions below.
+namespace CharProperties {
+	enum {
+		// The following categories are mutually exclusive and only apply to the
+		// ASCII 7 bit range of the UTF32 spectrum.
+		PROPERTY_UPPERCASE			= 0x0001,		// Upper case ASCII letter.
+		PROPERTY_LOWERCASE			= 0x0002,		// Lower case ASCII letter.
+		PROPERTY_DIGIT				= 0x0004,		// Digit 0-9.
+		PROPERTY_UNDERSCORE			= 0x0008,		// Underscore character.
+		PROPERTY_WHITESPACE			= 0x0020,		// Whitespace " \t\v\f\n" (not "\r").
+		PROPERTY_OTHER_BASIC_SOURCE = 0x0040,		// Other characters in basic source character set
+													// excluding the above.
+		PROPERTY_BAD_SOURCE			= 0x0080,		// A character not allowed as a source character
+		PROPERTY_OTHER_ASCII		= 0x0100,		// Other single ASCII character not listed above
+		// Other properties
+		PROPERTY_HEX_LETTER			= 0x0200,		// Hex letter from A to F or a to f
+		PROPERTY_PP_IDENTIFIER		= 0x0400,		// Allowed in a Pp identifier (any character range)
+	};
+
+	const Uint ASCII_MAX = 0x80u;
+
+	// The plane is split into pages of 256 characters and the page index gives
+	// the block of properties for each page. The table is generated at compile
+	// time in Char.cpp which also checks that BLOCK_COUNT is the number of
+	// blocks needed.
+	const Uint PAGE_SIZE = 256;
+	const Uint PAGE_COUNT = 256;
+	const Uint BLOCK_COUNT = 27;
+
+	struct Table {
+		Uint8 pageIndex[PAGE_COUNT];			// The block number of each page
+		Uint16 blocks[BLOCK_COUNT][PAGE_SIZE];	// The properties of each character
+
+		// Get the properties of a character. Characters beyond the plane
+		// (and EOF) have no properties.
+		constexpr Uint get(Uint32 ch) const {
+			return (ch < PAGE_COUNT * PAGE_SIZE) ? blocks[pageIndex[ch / PAGE_SIZE]][ch % PAGE_SIZE] : 0;
+		}
+	};
+
+	// The one copy of the table.
+	extern const Table TABLE;
+}
+
 // A single character as used for internal purposes. The character must either be a
 // valid character from the allowed UTF range or the special EOF character. The
 // internal representation of the character is currently UTF32 but this may change in future. 
 class Char {
 public:
 	// Default constructor. The value is the same as EOF.
-	Char();
+	constexpr Char() : ch_(CHAR_EOF) { }
 
 	// Constructor from ASCII value. The argument must be 7 bit ASCII.
-	Char(char ch);
+	constexpr Char(char ch) : ch_((Uint32)(Uint8)ch) { ASSERT((Uint8)ch < CharProperties::ASCII_MAX); }
 
 	// Returns true if an uppercase letter from 'A' to 'Z'.
-	bool isUpper() const;
+	bool isUpper() const { return hasProperty(CharProperties::PROPERTY_UPPERCASE); }
 
 	// Returns true if a lowercase letter from 'a' to 'z'.
-	bool isLower() const;
+	bool isLower() const { return hasProperty(CharProperties::PROPERTY_LOWERCASE); }
 
 	// Returns true if an uppercase or lowercase letter
 	// from 'A' to 'Z' or from 'a' to 'z'.
-	bool isLetter() const;
+	bool isLetter() const { return hasProperty(CharProperties::PROPERTY_UPPERCASE | CharProperties::PROPERTY_LOWERCASE); }
 
 	// Returns true if a digit from '0' to '9'.
-	bool isDecimalDigit() const;
+	bool isDecimalDigit() const { return hasProperty(CharProperties::PROPERTY_DIGIT); }
 
 	// Returns true if a binary digit of '0' or '1'.
-	bool isBinaryDigit() const;
+	constexpr bool isBinaryDigit() const { return (ch_ >= (Uint8)'0') && (ch_ <= (Uint8)'1'); }
 
 	// Returns true if a digit from '0' to '7'.
-	bool isOctalDigit() const;
+	constexpr bool isOctalDigit() const { return (ch_ >= (Uint8)'0') && (ch_ <= (Uint8)'7'); }
 
 	// Returns true if a hexadecimal digit from '0' to '9', 'A' to 'F' or 'a' to 'f'.
-	bool isHexDigit() const;
+	bool isHexDigit() const { return hasProperty(CharProperties::PROPERTY_DIGIT | CharProperties::PROPERTY_HEX_LETTER); }
 
 	// Returns true if a whitespace character i.e. one of the 5 characters in: " \t\v\f\n"
-	bool isWhitespace() const;
+	bool isWhitespace() const { return hasProperty(CharProperties::PROPERTY_WHITESPACE); }
 
 	// Returns true if a character from the C++ basic source character set (see CPP2.2[1]).
-	bool isBasicSource() const;
+	bool isBasicSource() const {
+		return hasProperty(CharProperties::PROPERTY_UPPERCASE | CharProperties::PROPERTY_LOWERCASE | CharProperties::PROPERTY_DIGIT |
+						   CharProperties::PROPERTY_UNDERSCORE | CharProperties::PROPERTY_WHITESPACE | CharProperties::PROPERTY_OTHER_BASIC_SOURCE);
+	}
 
 	// Returns true if a character which is allowed in a Pp identifier.
-	bool isPpIdentifier() const;
+	bool isPpIdentifier() const { return hasProperty(CharProperties::PROPERTY_PP_IDENTIFIER); }
 
 	// Returns true if the special character we have picked to represent end of file.
-	bool isEof() const;
+	constexpr bool isEof() const { return ch_ == CHAR_EOF; }
 
 	// Returns true if the character is from the ASCII range 0x00 to 0x7f
-	bool isAscii() const;
+	constexpr bool isAscii() const { return ch_ < CharProperties::ASCII_MAX; }
 
 	// Returns the decimal value of characters from '0' to '9'.
 	// The character must be a decimal digit.
-	Uint decimalValue() const;
+	Uint decimalValue() const { ASSERT(isDecimalDigit()); return (Uint)(ch_ - (Uint8)'0'); }
 
 	// Returns the binary value of characters of '0' and '1'.
 	// The character must be a binary digit.
-	Uint binaryValue() const;
+	constexpr Uint binaryValue() const { ASSERT(isBinaryDigit()); return (Uint)(ch_ - (Uint8)'0'); }
 
 	// Returns the octal value of characters from '0' to '7'.
 	// The character must be a octal digit.
-	Uint octalValue() const;
+	constexpr Uint octalValue() const { ASSERT(isOctalDigit()); return (Uint)(ch_ - (Uint8)'0'); }
 
 	// Returns the hexadecimal value of characters from '0' to '9', 'a' to 'f' or 'A' to 'F'.
 	// The character must be a hexadecimal digit.
@@ -67,22 +116,22 @@ public:
 
 	// Convert the character to uppercase if it is a lowercase letter from 'a' to 'z'
 	// otherwise return it unchanged.
-	Char toUpperCopy() const;
+	Char toUpperCopy() const { return Char(isLower() ? (ch_ - (Uint8)0x20) : ch_); }
 
 	// Convert the character to lowercase if it is uppercase letter from 'A' to 'Z'
 	// otherwise return it unchanged.
-	Char toLowerCopy() const;
+	Char toLowerCopy() const { return Char(isUpper() ? (ch_ + (Uint8)0x20) : ch_); }
 
 	// The EOF character
-	static Char eof();
+	static constexpr Char eof() { return Char(CHAR_EOF); }
 
 	// Get the character which represents the given decimal digit.
 	// The value must be in the range 0 to 9.
-	static Char decimalDigit(Uint value);
+	static constexpr Char decimalDigit(Uint value) { ASSERT(value < 10); return Char((Uint32)'0' + value); }
 
 	// Get the character which represents the given octal digit
 	// The value must be in the range 0 to 7.
-	static Char octalDigit(Uint value);
+	static constexpr Char octalDigit(Uint value) { ASSERT(value < 8); return Char((Uint32)'0' + value); }
 
 	// Get the character which represents the given hex digit.
 	// The value must be in the range 0 to 15.
@@ -103,7 +152,9 @@ public:
 
 	// Create a character from a UTF32 word. Returns the character on success or
 	// EOF on failure. 
-	static Char fromUtf32(char32_t utf32);
+	static constexpr Char fromUtf32(char32_t utf32) {
+		return (((utf32 >= 0x0000d800u) && (utf32 < 0x0000e000u)) || (utf32 >= 0x00110000u)) ? Char(CHAR_EOF) : Char((Uint32)utf32);
+	}
 
 	// Converts the character to 1 to 4 UTF8 bytes. Returns the number of UTF8 bytes converted.
 	// utf8 must have room for 4 bytes.
@@ -114,23 +165,33 @@ public:
 	Uint toUtf16(char16_t* utf16);
 
 	// Converts the character to 1 UTF32 word. EOF is converted to (char32_t)-1.
-	char32_t toUtf32();
+	constexpr char32_t toUtf32() { return (char32_t)ch_; }
 
 	// Comparison. Tests whether this character and another are identical.
-	bool operator==(Char other) const;
-	bool operator!=(Char other) const;
+	constexpr bool operator==(Char other) const { return ch_ == other.ch_; }
+	constexpr bool operator!=(Char other) const { return ch_ != other.ch_; }
 
 	// Comparison against char. The char must be a 7 bit ASCII value.
-	bool operator==(char other) const;
-	bool operator!=(char other) const;
+	constexpr bool operator==(char other) const { ASSERT((Uint)other < CharProperties::ASCII_MAX); return ch_ == (Uint32)other; }
+	constexpr bool operator!=(char other) const { ASSERT((Uint)other < CharProperties::ASCII_MAX); return ch_ != (Uint32)other; }
 
 private:
 	// Construct from the supplied value which must be valid UTF32 or EOF.
-	Char(Uint32 ch);
+	constexpr Char(Uint32 ch) : ch_(ch) {
+		ASSERT((ch < 0x0000d800u) ||
+			   ((ch >= 0x0000e000u) && (ch < 0x00110000u)) ||
+			   (ch == CHAR_EOF));
+	}
+
+	// Returns true if the character has any of the given properties.
+	bool hasProperty(Uint mask) const { return (CharProperties::TABLE.get(ch_) & mask) != 0; }
 
 private:
 	friend class String;
 
+	// The value of the EOF character.
+	static const Uint32 CHAR_EOF = 0xffffffffu;
+
 	// The character value in UTF32 or (Uint32)-1 for EOF.
 	Uint32 ch_;
 };
@@ -3,23 +3,7 @@
 #include "Util/OutputStream.hpp"
 
 namespace {
-	// The properties of a source character (i.e. a character in a source file).
-	// These characters are UTF32.
-	enum {
-		// The following categories are mutually exclusive and only apply to the
-		// ASCII 7 bit range of the UTF32 spectrum.
-		PROPERTY_UPPERCASE			= 0x0001,		// Upper case ASCII letter.
-		PROPERTY_LOWERCASE			= 0x0002,		// Lower case ASCII letter.
-		PROPERTY_DIGIT				= 0x0004,		// Digit 0-9.
-		PROPERTY_UNDERSCORE			= 0x0008,		// Underscore character.
-		PROPERTY_WHITESPACE			= 0x0020,		// Whitespace " \t\v\f\n" (not "\r").
-		PROPERTY_OTHER_BASIC_SOURCE = 0x0040,		// Other characters in basic source character set
-													// excluding the above.
-		PROPERTY_BAD_SOURCE			= 0x0080,		// A character not allowed as a source character
-		PROPERTY_OTHER_ASCII		= 0x0100,		// Other single ASCII character not listed above
-		// Other properties
-		PROPERTY_HEX_LETTER			= 0x0200,		// Hex letter from A to F or a to f
-	};
+	using namespace CharProperties;
 
 #define U PROPERTY_UPPERCASE
 #define L PROPERTY_LOWERCASE
@@ -31,8 +15,8 @@ namespace {
 #define O PROPERTY_OTHER_ASCII		// 0x24 $, 0x40 @, 0x60 `
 #define H PROPERTY_HEX_LETTER
 
-	const Uint ASCII_MAX = 0x80u;
-	const Uint PROPERTIES[ASCII_MAX] =
+	// The properties of the ASCII characters.
+	constexpr Uint PROPERTIES[ASCII_MAX] =
 	{	/*              0		1		2		3		4		5		6		7		8		9		A		B		C		D		E		F	
 		/* 00 */		B,		B,		B,		B,		B,		B,		B,		B,		B,		W,		W,		W,		W,		B,		B,		B,
 		/* 10 */		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,		B,
@@ -44,10 +28,22 @@ namespace {
 		/* 70 */		L,		L,		L,		L,		L,		L,		L,		L,		L,		L,		L,		S,		S,		S,		S,		B,
 	};
 
-	const struct {
+#undef U
+#undef L
+#undef D
+#undef _
+#undef W
+#undef S
+#undef B
+#undef O
+#undef H
+
+	// The ranges of non-ASCII characters allowed in a Pp identifier.
+	struct IdentifierRange {
 		Uint32 first;
 		Uint32 last;
-	} UTF32_IDENTIFIER_RANGES[] =
+	};
+	constexpr IdentifierRange UTF32_IDENTIFIER_RANGES[] =
 	{
 		{0x00c0, 0x00d6}, {0x00d8, 0x00f6}, {0x00f8, 0x01f5}, {0x01fa, 0x0217}, {0x0250, 0x02a8}, {0x0384, 0x0384}, {0x0388, 0x038a}, {0x038c, 0x038c},
 		{0x038e, 0x03a1}, {0x03a3, 0x03ce}, {0x03d0, 0x03d6}, {0x03da, 0x03da}, {0x03dc, 0x03dc}, {0x03de, 0x03de}, {0x03e0, 0x03e0}, {0x03e2, 0x03f3},
@@ -74,115 +70,125 @@ namespace {
 	};
 	const Uint N_UTF32_IDENTIFIER_RANGES = sizeof(UTF32_IDENTIFIER_RANGES) / sizeof(UTF32_IDENTIFIER_RANGES[0]);
 
-	class Utf32IdentifierRangesSelfTest {
-	public:
-		Utf32IdentifierRangesSelfTest() {
-			Uint32 last = 0;
+	// The properties of all the characters in the Basic Multilingual Plane
+	// are held in CharProperties::TABLE. Pages with no properties share one
+	// block as do pages which are all identifier characters so only the pages
+	// which are a mixture need a block of their own.
+	const Uint EMPTY_BLOCK = 0;
+	const Uint IDENTIFIER_BLOCK = 1;
+
+	// The number of identifier characters in each page.
+	struct PageCoverage {
+		Uint count[PAGE_COUNT];
+		constexpr PageCoverage() : count() {
 			for (Uint i = 0; i < N_UTF32_IDENTIFIER_RANGES; i++) {
-				ASSERT(UTF32_IDENTIFIER_RANGES[i].first >= last + 2);
-				ASSERT(UTF32_IDENTIFIER_RANGES[i].last >= UTF32_IDENTIFIER_RANGES[i].first);
-				last = UTF32_IDENTIFIER_RANGES[i].last;
+				Uint32 first = UTF32_IDENTIFIER_RANGES[i].first;
+				Uint32 last = UTF32_IDENTIFIER_RANGES[i].last;
+				for (Uint32 page = first / PAGE_SIZE; page <= last / PAGE_SIZE; page++) {
+					Uint32 pageFirst = page * PAGE_SIZE;
+					Uint32 pageLast = pageFirst + PAGE_SIZE - 1;
+					count[page] += ((last < pageLast) ? last : pageLast) - ((first > pageFirst) ? first : pageFirst) + 1;
+				}
 			}
 		}
-	};
-	const Utf32IdentifierRangesSelfTest utf32IdentifierRangesSelfTest();
-
-	const Uint32 CHAR_EOF = (Uint32)-1;
-}
-
-Char::Char() :
-	ch_(CHAR_EOF)
-{
-}
-
-Char::Char(char ch) :
-	ch_((Uint32)(Uint8)ch)
-{
-	ASSERT((Uint8)ch < ASCII_MAX);
-}
-
-bool Char::isUpper() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & PROPERTY_UPPERCASE) != 0));
-}
-
-bool Char::isLower() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & PROPERTY_LOWERCASE) != 0));
-}
-
-bool Char::isLetter() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & (PROPERTY_UPPERCASE | PROPERTY_LOWERCASE)) != 0));
-}
-
-bool Char::isDecimalDigit() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & PROPERTY_DIGIT) != 0));
-}
-
-bool Char::isBinaryDigit() const {
-	return (ch_ >= (Uint8)'0') && (ch_ <= (Uint8)'1');
-}
 
-bool Char::isOctalDigit() const {
-	return (ch_ >= (Uint8)'0') && (ch_ <= (Uint8)'7');
-}
-
-bool Char::isHexDigit() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & (PROPERTY_DIGIT | PROPERTY_HEX_LETTER)) != 0));
-}
-
-bool Char::isWhitespace() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & PROPERTY_WHITESPACE) != 0));
-}
-
-bool Char::isBasicSource() const {
-	return ((ch_ < ASCII_MAX) && ((PROPERTIES[ch_] & (PROPERTY_UPPERCASE | PROPERTY_LOWERCASE | PROPERTY_DIGIT | PROPERTY_UNDERSCORE | PROPERTY_WHITESPACE | PROPERTY_OTHER_BASIC_SOURCE)) != 0));
-}
+		// Returns true if a page needs a block of its own. The ASCII page
+		// always does.
+		constexpr bool isMixed(Uint page) const {
+			return (page == 0) || ((count[page] != 0) && (count[page] != PAGE_SIZE));
+		}
 
-bool Char::isPpIdentifier() const {
-	if (ch_ < ASCII_MAX) {
-		return ((PROPERTIES[ch_] & (PROPERTY_UPPERCASE | PROPERTY_LOWERCASE | PROPERTY_DIGIT | PROPERTY_UNDERSCORE)) != 0);
-	}
-	// ch_ could lie in one of the ranges from [lo] to [hi]
-	Uint lo = 0;
-	Uint hi = N_UTF32_IDENTIFIER_RANGES - 1;
-	if (ch_ < UTF32_IDENTIFIER_RANGES[0].first) return false;
-	if (ch_ > UTF32_IDENTIFIER_RANGES[N_UTF32_IDENTIFIER_RANGES - 1].last) return false;
-	while (lo <= hi) {
-		Uint mid = (lo + hi) / 2;
-		if (ch_ < UTF32_IDENTIFIER_RANGES[mid].first) {
-			// Cannot be -1 because of check at start
-			hi = mid - 1;
+		// Get the number of blocks needed.
+		constexpr Uint blockCount() const {
+			Uint ret = IDENTIFIER_BLOCK + 1;
+			for (Uint page = 0; page < PAGE_COUNT; page++) {
+				ret += isMixed(page) ? 1 : 0;
+			}
+			return ret;
 		}
-		else if (ch_ > UTF32_IDENTIFIER_RANGES[mid].last) {
-			lo = mid + 1;
+	};
+	constexpr PageCoverage PAGE_COVERAGE;
+	static_assert(PAGE_COVERAGE.blockCount() == BLOCK_COUNT, "CharProperties::BLOCK_COUNT does not match UTF32_IDENTIFIER_RANGES");
+
+	// Generate the property table.
+	constexpr Table makeTable() {
+		Table table{};
+		Uint nextBlock = IDENTIFIER_BLOCK + 1;
+		for (Uint page = 0; page < PAGE_COUNT; page++) {
+			table.pageIndex[page] = (Uint8)(PAGE_COVERAGE.isMixed(page) ? nextBlock++ :
+										(PAGE_COVERAGE.count[page] == 0) ? EMPTY_BLOCK : IDENTIFIER_BLOCK);
+		}
+		for (Uint i = 0; i < PAGE_SIZE; i++) {
+			table.blocks[IDENTIFIER_BLOCK][i] = PROPERTY_PP_IDENTIFIER;
 		}
-		else {
-			return true;
+		for (Uint ch = 0; ch < ASCII_MAX; ch++) {
+			bool isIdentifier = (PROPERTIES[ch] & (PROPERTY_UPPERCASE | PROPERTY_LOWERCASE | PROPERTY_DIGIT | PROPERTY_UNDERSCORE)) != 0;
+			table.blocks[table.pageIndex[0]][ch] = (Uint16)(PROPERTIES[ch] | (isIdentifier ? PROPERTY_PP_IDENTIFIER : 0));
 		}
+		for (Uint i = 0; i < N_UTF32_IDENTIFIER_RANGES; i++) {
+			for (Uint32 ch = UTF32_IDENTIFIER_RANGES[i].first; ch <= UTF32_IDENTIFIER_RANGES[i].last; ch++) {
+				Uint block = table.pageIndex[ch / PAGE_SIZE];
+				if (block == IDENTIFIER_BLOCK) {
+					// Skip to the last character of the page
+					ch |= PAGE_SIZE - 1;
+				}
+				else {
+					table.blocks[block][ch % PAGE_SIZE] |= PROPERTY_PP_IDENTIFIER;
+				}
+			}
+		}
+		return table;
 	}
-	return false;
 }
 
-bool Char::isEof() const {
-	return ch_ == CHAR_EOF;
-}
-
-bool Char::isAscii() const {
-	return ch_ < ASCII_MAX;
-}
-
-Uint Char::decimalValue() const {
-	ASSERT(isDecimalDigit());
-	return (Uint)(ch_ - (Uint8)'0');
-}
+// The one copy of the property table.
+constexpr Table CharProperties::TABLE = makeTable();
 
-Uint Char::binaryValue() const {
-	ASSERT(isBinaryDigit());
-	return (Uint)(ch_ - (Uint8)'0');
-}
-
-Uint Char::octalValue() const {
-	ASSERT(isOctalDigit());
-	return (Uint)(ch_ - (Uint8)'0');
+namespace {
+	// Check that the identifier ranges are in order, do not overlap, are
+	// non-ASCII and are within the Basic Multilingual Plane. Some ranges are
+	// adjacent.
+	constexpr bool identifierRangesAreValid() {
+		Uint32 last = ASCII_MAX - 1;
+		for (Uint i = 0; i < N_UTF32_IDENTIFIER_RANGES; i++) {
+			if ((UTF32_IDENTIFIER_RANGES[i].first <= last) ||
+				(UTF32_IDENTIFIER_RANGES[i].last < UTF32_IDENTIFIER_RANGES[i].first) ||
+				(UTF32_IDENTIFIER_RANGES[i].last >= PAGE_COUNT * PAGE_SIZE))
+			{
+				return false;
+			}
+			last = UTF32_IDENTIFIER_RANGES[i].last;
+		}
+		return true;
+	}
+	static_assert(identifierRangesAreValid(), "Invalid UTF32_IDENTIFIER_RANGES");
+
+	// Check that the table has the identifier property at both ends of every
+	// range and not just outside them (unless the next range is adjacent),
+	// and that every block is used.
+	constexpr bool propertyTableMatchesRanges() {
+		Uint32 previousLast = 0;
+		for (Uint i = 0; i < N_UTF32_IDENTIFIER_RANGES; i++) {
+			Uint32 first = UTF32_IDENTIFIER_RANGES[i].first;
+			Uint32 last = UTF32_IDENTIFIER_RANGES[i].last;
+			bool beforeIsIdentifier = (first - 1 == previousLast);
+			bool afterIsIdentifier = (i + 1 < N_UTF32_IDENTIFIER_RANGES) && (UTF32_IDENTIFIER_RANGES[i + 1].first == last + 1);
+			if (((TABLE.get(first) & PROPERTY_PP_IDENTIFIER) == 0) ||
+				((TABLE.get(last) & PROPERTY_PP_IDENTIFIER) == 0) ||
+				(((TABLE.get(first - 1) & PROPERTY_PP_IDENTIFIER) != 0) != beforeIsIdentifier) ||
+				(((TABLE.get(last + 1) & PROPERTY_PP_IDENTIFIER) != 0) != afterIsIdentifier))
+			{
+				return false;
+			}
+			previousLast = last;
+		}
+		Uint usedBlocks = IDENTIFIER_BLOCK + 1;
+		for (Uint page = 0; page < PAGE_COUNT; page++) {
+			usedBlocks += (TABLE.pageIndex[page] > IDENTIFIER_BLOCK) ? 1 : 0;
+		}
+		return (usedBlocks == BLOCK_COUNT) && (TABLE.get(0x10000u) == 0);
+	}
+	static_assert(propertyTableMatchesRanges(), "CharProperties::TABLE does not match UTF32_IDENTIFIER_RANGES");
 }
 
 Uint Char::hexValue() const {
@@ -197,28 +203,6 @@ Uint Char::hexValue() const {
 	return (Uint)(ch_ - (Uint8)'a') + 10u;
 }
 
-Char Char::toUpperCopy() const {
-	return Char(isLower() ? (ch_ - (Uint8)0x20) : ch_);
-}
-
-Char Char::toLowerCopy() const {
-	return Char(isUpper() ? (ch_ + (Uint8)0x20) : ch_);
-}
-
-Char Char::eof() {
-	return Char(CHAR_EOF);
-}
-
-Char Char::decimalDigit(Uint value) {
-	ASSERT(value < 10);
-	return Char((Uint32)'0' + value);
-}
-
-Char Char::octalDigit(Uint value) {
-	ASSERT(value < 8);
-	return Char((Uint32)'0' + value);
-}
-
 Char Char::hexDigit(Uint value, bool upperNotLower) {
 	ASSERT(value < 16);
 	if (value < 10) {
@@ -314,15 +298,6 @@ Char Char::fromUtf16(const char16_t* utf16, Uint& len) {
 	return Char((Uint32)(((utf16[0] & 0x03ffu) << 10) | (utf16[1] & 0x03ffu)) + 0x10000u);
 }
 
-Char Char::fromUtf32(char32_t utf32) {
-	if (((utf32 >= 0x0000d800u) && (utf32 < 0x0000e000u)) ||
-		(utf32 >= 0x00110000))
-	{
-		return Char(CHAR_EOF);
-	}
-	return Char((Uint32)utf32);
-}
-
 Uint Char::toUtf8(char* utf8) {
 	if (ch_ < 0x80u) {
 		// One byte character U+0000 to U+007F
@@ -368,36 +343,6 @@ Uint Char::toUtf16(char16_t* utf16) {
 	}
 }
 
-char32_t Char::toUtf32() {
-	return (char32_t)ch_;
-}
-
-bool Char::operator==(Char other) const {
-	return ch_ == other.ch_;
-}
-
-bool Char::operator!=(Char other) const {
-	return ch_ != other.ch_;
-}
-
-bool Char::operator==(char other) const {
-	ASSERT((Uint)other < ASCII_MAX);
-	return ch_ == (Uint32)other;
-}
-
-bool Char::operator!=(char other) const {
-	ASSERT((Uint)other < ASCII_MAX);
-	return ch_ != (Uint32)other;
-}
-
-Char::Char(Uint32 ch) :
-	ch_(ch)
-{
-	ASSERT ((ch < 0x0000d800u) ||
-		    ((ch >= 0x0000e000u) && (ch < 0x00110000u)) ||
-		    (ch == CHAR_EOF));
-}
-
 OutputStream& operator<<(OutputStream& os, Char ch) {
 	os.streamChar(ch);
 	return os;
@@ -28,6 +28,51 @@ CharEncoding::CharEncoding(Ordinal ordinal) :
 {
 }
 
+CharEncoding CharEncoding::fromBom(const char* data, Uint size, Uint& bomSize) {
+	if ((size >= 3) &&
+		(data[0] == (char)0xef) &&
+		(data[1] == (char)0xbb) &&
+		(data[2] == (char)0xbf))
+	{
+		bomSize = 3;
+		return UTF8;
+	}
+	else if ((size >= 4) &&
+		(data[0] == (char)0x00) &&
+		(data[1] == (char)0x00) &&
+		(data[2] == (char)0xfe) &&
+		(data[3] == (char)0xff))
+	{
+		bomSize = 4;
+		return UTF32BE;
+	}
+	else if ((size >= 4) &&
+		(data[0] == (char)0xff) &&
+		(data[1] == (char)0xfe) &&
+		(data[2] == (char)0x00) &&
+		(data[3] == (char)0x00))
+	{
+		bomSize = 4;
+		return UTF32LE;
+	}
+	else if ((size >= 2) &&
+		(data[0] == (char)0xfe) &&
+		(data[1] == (char)0xff))
+	{
+		bomSize = 2;
+		return UTF16BE;
+	}
+	else if ((size >= 2) &&
+		(data[0] == (char)0xff) &&
+		(data[1] == (char)0xfe))
+	{
+		bomSize = 2;
+		return UTF16LE;
+	}
+	bomSize = 0;
+	return INVALID;
+}
+
 bool CharEncoding::isValid() const {
 	return ordinal_ != INVALID;
 }
@@ -63,6 +63,20 @@ void CharInputConverter::convertAppend(const std::string& src, String& dst) {
 	convertAppend(src.c_str(), (Uint)src.size(), dst);
 }
 
+Uint CharInputConverter::convertAppendAvailable(const char* src, Uint srcLen, String& dst) {
+	const char* p = src;
+	Uint remaining = srcLen;
+	while (remaining >= MAX_INPUT_CHAR_BYTES) {
+		std::pair<Uint, Char> out = convertChar(p, remaining);
+		ASSERT(out.first > 0);
+		ASSERT(out.first <= remaining);
+		p += out.first;
+		remaining -= out.first;
+		dst += out.second;
+	}
+	return srcLen - remaining;
+}
+
 String CharInputConverter::convertString(const char* src, Uint srcLen) {
 	String ret;
 	convertAppend(src, srcLen, ret);
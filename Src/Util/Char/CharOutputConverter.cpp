@@ -38,22 +38,31 @@ CharOutputConverterPtr CharOutputConverter::create(CharEncoding dstEncoding) {
 CharOutputConverter::~CharOutputConverter() {
 }
 
-bool CharOutputConverter::convertAppend(const String& src, std::string& dst) {
+bool CharOutputConverter::convertAppendUtf8(const char* src, Uint len, std::string& dst) {
 	bool ret = true;
 	char buf[CharOutputConverter::MAX_OUTPUT_CHAR_BYTES];
-	for (StringIter pos = src.begin(); !pos.atEnd(); ++pos) {
-		Uint len = convertChar(*pos, buf);
-		if (len == 0) {
+	Uint pos = 0;
+	while (pos < len) {
+		Uint charLen = 0;
+		Char ch = Char::fromUtf8(src + pos, charLen);
+		ASSERT(!ch.isEof() && (charLen <= len - pos));
+		pos += charLen;
+		Uint dstLen = convertChar(ch, buf);
+		if (dstLen == 0) {
 			ret = false;
 		}
 		else {
-			ASSERT(len <= CharOutputConverter::MAX_OUTPUT_CHAR_BYTES);
-			dst.append(buf, len);
+			ASSERT(dstLen <= CharOutputConverter::MAX_OUTPUT_CHAR_BYTES);
+			dst.append(buf, dstLen);
 		}
 	}
 	return ret;
 }
 
+bool CharOutputConverter::convertAppend(const String& src, std::string& dst) {
+	return convertAppendUtf8(src.str_.data(), (Uint)src.str_.size(), dst);
+}
+
 std::string CharOutputConverter::convertString(const String& src) {
 	std::string ret;
 	if (!convertAppend(src, ret)) {
@@ -2,8 +2,10 @@
 #include <codecvt>
 #include <cwchar>
 #include <locale>
+#include <vector>
 #include "Util/Assert.hpp"
 #include "Util/Char/Utf16CharOutputConverter.hpp"
+#include "Util/Char/Utf16Scan.hpp"
 #include "Util/CharOutputConverter.hpp"
 #include "Util/Def.hpp"
 
@@ -24,7 +26,8 @@ public:
 		// "C" locale.
 		defaultLocale_(isAnsiNotOem ? "": ".OCP"),
 		facet_(std::use_facet<CodecvtType>(defaultLocale_)),
-		mbstate_(std::mbstate_t())
+		mbstate_(std::mbstate_t()),
+		wbuf_()
 	{
 		ASSERT(sizeof(wchar_t) == 2);
 	}
@@ -60,11 +63,41 @@ public:
 		return outBufLen;
 	}
 
+	bool convertAppendUtf8(const char* src, Uint len, std::string& dst) {
+		if (len == 0) {
+			return true;
+		}
+
+		// Convert to UTF16 and then encode it all with one call to the facet
+		// which writes at most 4 bytes for each UTF16 word
+		wbuf_.resize(len);
+		Uint wlen = Utf16Scan::fromUtf8(src, len, wbuf_.data());
+		std::string::size_type oldSize = dst.size();
+		dst.resize(oldSize + 4u * wlen);
+		const wchar_t* pwbuf = nullptr;
+		char* pout = nullptr;
+		CodecvtType::result codecvtResult = facet_.out(
+				mbstate_,
+				wbuf_.data(), wbuf_.data() + wlen, pwbuf,
+				&dst[oldSize], &dst[oldSize] + 4u * wlen, pout);
+		if ((codecvtResult == CodecvtType::ok) && (pwbuf == wbuf_.data() + wlen)) {
+			dst.resize((std::string::size_type)(pout - dst.data()));
+			return true;
+		}
+
+		// A character cannot be encoded so convert one character at a time
+		// skipping the ones which cannot be encoded
+		dst.resize(oldSize);
+		mbstate_ = std::mbstate_t();
+		return CharOutputConverter::convertAppendUtf8(src, len, dst);
+	}
+
 private:
 	std::locale defaultLocale_;
 	typedef std::codecvt<wchar_t, char, std::mbstate_t> CodecvtType;
 	const CodecvtType& facet_;
 	std::mbstate_t mbstate_;
+	std::vector<wchar_t> wbuf_;		// The UTF16 for convertAppendUtf8()
 };
 
 #endif
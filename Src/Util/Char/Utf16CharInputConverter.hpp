@@ -1,9 +1,12 @@
 #pragma once
 #include <algorithm>
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
+#include "Util/Char/Utf16Scan.hpp"
 #include "Util/CharInputConverter.hpp"
 #include "Util/Def.hpp"
+#include "Util/String.hpp"
 
 // A character input converter from the UTF16BE and UTF16LE character encodings.
 class Utf16CharInputConverter : public CharInputConverter {
@@ -47,6 +50,54 @@ public:
 		return std::make_pair(len * 2u, ch);
 	}
 
+	// Bulk conversion. Runs of words are converted straight to UTF8 in a local
+	// buffer which is appended to the destination in one go. Only unpaired
+	// surrogates and characters cut short by the end of the buffer go through
+	// convertChar() and they are reached with everything before them already
+	// appended.
+	using CharInputConverter::convertAppend;
+	void convertAppend(const char* src, Uint srcLen, String& dst) {
+		convertRuns(src, srcLen, 1u, dst);
+	}
+
+	Uint convertAppendAvailable(const char* src, Uint srcLen, String& dst) {
+		return convertRuns(src, srcLen, MAX_INPUT_CHAR_BYTES, dst);
+	}
+
+private:
+	// The maximum number of words converted into the local buffer at a time.
+	static const Uint CHUNK_WORDS = 256;
+
+	// Converts characters until fewer than minRemaining source bytes are left.
+	// Returns the number of source bytes consumed.
+	Uint convertRuns(const char* src, Uint srcLen, Uint minRemaining, String& dst) {
+		ASSERT(minRemaining > 0);
+		const char* p = src;
+		Uint remaining = srcLen;
+		char buf[3 * CHUNK_WORDS];
+		while (remaining >= minRemaining) {
+			// Only convert characters which start before the last minRemaining - 1 bytes
+			Uint completeWords = remaining / 2u;
+			Uint startWords = std::min(std::min((remaining - minRemaining) / 2u + 1u, completeWords), (Uint)CHUNK_WORDS);
+			Uint bufLen = 0;
+			Uint words = Utf16Scan::toUtf8(p, startWords, completeWords, reverse_, buf, bufLen);
+			dst.streamUtf8(buf, bufLen);
+			p += 2u * words;
+			remaining -= 2u * words;
+			if ((startWords != 0) && (words >= startWords)) {
+				continue;
+			}
+
+			std::pair<Uint, Char> out = convertChar(p, remaining);
+			ASSERT(out.first > 0);
+			ASSERT(out.first <= remaining);
+			p += out.first;
+			remaining -= out.first;
+			dst += out.second;
+		}
+		return srcLen - remaining;
+	}
+
 private:
 	bool reverse_;
 };
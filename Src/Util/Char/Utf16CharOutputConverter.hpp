@@ -1,6 +1,7 @@
 #pragma once
 #include <deque>
 #include "Util/Assert.hpp"
+#include "Util/Char/Utf16Scan.hpp"
 #include "Util/CharOutputConverter.hpp"
 #include "Util/Def.hpp"
 
@@ -32,7 +33,35 @@ public:
 		return ret;
 	}
 
+	bool convertAppendUtf8(const char* src, Uint len, std::string& dst) {
+		// Convert a block at a time with each block ending at the start of
+		// a character
+		char16_t words[BLOCK_BYTES];
+		while (len > 0) {
+			Uint blockLen = len;
+			if (blockLen > BLOCK_BYTES) {
+				blockLen = BLOCK_BYTES;
+				while (((Uint8)src[blockLen] & 0xc0u) == 0x80u) {
+					blockLen--;
+				}
+			}
+			Uint count = Utf16Scan::fromUtf8(src, blockLen, words);
+			if (reverse_) {
+				for (Uint i = 0; i < count; i++) {
+					words[i] = (char16_t)((words[i] >> 8) | (words[i] << 8));
+				}
+			}
+			dst.append((const char*)words, 2 * count);
+			src += blockLen;
+			len -= blockLen;
+		}
+		return true;
+	}
+
 private:
+	// The number of UTF8 bytes converted at a time
+	static const Uint BLOCK_BYTES = 1024;
+
 	bool reverse_;
 };
 
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstring>
+#include "Util/Char/Utf8Scan.hpp"
+#include "Util/Def.hpp"
+
+// Bulk conversion between UTF16 and UTF8 without constructing a Char for each
+// character. These are used by the UTF16 input converter and for platform
+// strings which are UTF16 for Windows compilers. Blocks of ASCII are handled
+// 16 (AVX2) or 8 (SSE2) words at a time.
+namespace Utf16Scan {
+
+	// Get the UTF16 word at src swapping the bytes if reverse is true.
+	inline Uint32 getWord(const char* src, bool reverse) {
+		Uint16 w;
+		memcpy(&w, src, 2u);
+		return reverse ? (Uint32)(Uint16)((w << 8) | (w >> 8)) : (Uint32)w;
+	}
+
+	// Converts the characters which start within the first startWords UTF16
+	// words at src (with the bytes of each word swapped if reverse is true)
+	// writing the UTF8 to dst (which must have room for 3 bytes per word) and
+	// adding its length to dstLen. A surrogate pair is only converted if both
+	// words are within the first completeWords words. Stops at the first word
+	// which is an unpaired surrogate or a pair cut short by completeWords.
+	// Returns the number of words converted.
+	inline Uint toUtf8(const char* src, Uint startWords, Uint completeWords, bool reverse, char* dst, Uint& dstLen) {
+		Uint pos = 0;
+		while (pos < startWords) {
+#if BUILD(AVX2)
+			// 16 ASCII words at a time
+			if (pos + 16u <= startWords) {
+				__m256i v = _mm256_loadu_si256((const __m256i*)(src + 2u * pos));
+				if (reverse) {
+					v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+				}
+				__m256i high = _mm256_and_si256(v, _mm256_set1_epi16((short)0xff80));
+				if ((Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi16(high, _mm256_setzero_si256())) == 0xffffffffu) {
+					__m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xd8);
+					_mm_storeu_si128((__m128i*)(dst + dstLen), _mm256_castsi256_si128(bytes));
+					dstLen += 16u;
+					pos += 16u;
+					continue;
+				}
+			}
+#endif
+#if BUILD(SSE2)
+			// 8 words at a time. ASCII words are packed into bytes and words up
+			// to the first surrogate are converted without further checks.
+			if (pos + 8u <= startWords) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(src + 2u * pos));
+				if (reverse) {
+					v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+				}
+				__m128i high = _mm_and_si128(v, _mm_set1_epi16((short)0xff80));
+				if ((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xffffu) {
+					_mm_storel_epi64((__m128i*)(dst + dstLen), _mm_packus_epi16(v, v));
+					dstLen += 8u;
+					pos += 8u;
+					continue;
+				}
+				__m128i surrogate = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xf800)), _mm_set1_epi16((short)0xd800));
+				Uint32 surrogates = (Uint32)_mm_movemask_epi8(surrogate);
+				Uint end = pos + ((surrogates == 0) ? 8u : Utf8Scan::lowestSetBit(surrogates) / 2u);
+				for (; pos < end; pos++) {
+					dstLen += Utf8Scan::encode(getWord(src + 2u * pos, reverse), dst + dstLen);
+				}
+				if (surrogates == 0) {
+					continue;
+				}
+			}
+#endif
+			// One character at a time
+			Uint32 w = getWord(src + 2u * pos, reverse);
+			if ((w < 0xd800u) || (w >= 0xe000u)) {
+				dstLen += Utf8Scan::encode(w, dst + dstLen);
+				pos++;
+				continue;
+			}
+			if ((w >= 0xdc00u) || (pos + 1u >= completeWords)) {
+				return pos;
+			}
+			Uint32 w2 = getWord(src + 2u * (pos + 1u), reverse);
+			if ((w2 < 0xdc00u) || (w2 >= 0xe000u)) {
+				return pos;
+			}
+			dstLen += Utf8Scan::encode((((w & 0x03ffu) << 10) | (w2 & 0x03ffu)) + 0x10000u, dst + dstLen);
+			pos += 2u;
+		}
+		return pos;
+	}
+
+	// Converts the valid UTF8 string src of length srcLen to UTF16 words in
+	// the host byte order in dst. No character has more UTF16 words than UTF8
+	// bytes so dst must have room for srcLen words. Returns the number of
+	// words written. Word is a 16 bit character type such as char16_t or
+	// wchar_t for Windows compilers.
+	template<class Word> inline Uint fromUtf8(const char* src, Uint srcLen, Word* dst) {
+		static_assert(sizeof(Word) == 2, "UTF16 words must be 16 bits");
+		Uint in = 0;
+		Uint out = 0;
+		while (in < srcLen) {
+#if BUILD(SSE2)
+			// 16 bytes at a time widening any ASCII before the first other byte
+			if (in + 16u <= srcLen) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(src + in));
+				Uint32 mask = (Uint32)_mm_movemask_epi8(v);
+				if (mask == 0) {
+					_mm_storeu_si128((__m128i*)(dst + out), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+					_mm_storeu_si128((__m128i*)(dst + out + 8u), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+					in += 16u;
+					out += 16u;
+					continue;
+				}
+				for (Uint end = in + Utf8Scan::lowestSetBit(mask); in < end; in++, out++) {
+					dst[out] = (Word)(Uint8)src[in];
+				}
+			}
+#endif
+			Uint len = 0;
+			Uint32 ch = Utf8Scan::decode(src + in, len);
+			in += len;
+			if (ch < 0x10000u) {
+				dst[out++] = (Word)ch;
+			}
+			else {
+				dst[out++] = (Word)(0xd800u + ((ch - 0x10000u) >> 10));
+				dst[out++] = (Word)(0xdc00u + (ch & 0x3ffu));
+			}
+		}
+		return out;
+	}
+}
@@ -1,8 +1,12 @@
 #pragma once
+#include <algorithm>
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/CharInputConverter.hpp"
 #include "Util/Def.hpp"
+#include "Util/String.hpp"
 
 // A character input converter from the UTF32BE and UTF32LE character encoding.
 class Utf32CharInputConverter : public CharInputConverter {
@@ -40,6 +44,119 @@ public:
 		return std::make_pair(4u, ch);
 	}
 
+	// Bulk conversion. Runs of valid characters are converted straight to UTF8
+	// in a local buffer which is appended to the destination in one go. Only
+	// invalid characters and a partial character at the end of the buffer go
+	// through convertChar() and they are reached with everything before them
+	// already appended.
+	using CharInputConverter::convertAppend;
+	void convertAppend(const char* src, Uint srcLen, String& dst) {
+		convertRuns(src, srcLen, 1u, dst);
+	}
+
+	Uint convertAppendAvailable(const char* src, Uint srcLen, String& dst) {
+		return convertRuns(src, srcLen, MAX_INPUT_CHAR_BYTES, dst);
+	}
+
+private:
+	// The maximum number of characters converted into the local buffer at a time.
+	static const Uint CHUNK_CHARS = 256;
+
+	// Get the character at src in the host byte order.
+	Uint32 getChar(const char* src) const {
+		Uint32 u;
+		memcpy(&u, src, 4u);
+		return reverse_ ? (u >> 24) | ((u >> 8) & 0xff00u) | ((u << 8) & 0xff0000u) | (u << 24) : u;
+	}
+
+	// Converts characters until fewer than minRemaining source bytes are left.
+	// Returns the number of source bytes consumed.
+	Uint convertRuns(const char* src, Uint srcLen, Uint minRemaining, String& dst) {
+		ASSERT(minRemaining > 0);
+		const char* p = src;
+		Uint remaining = srcLen;
+		char buf[4 * CHUNK_CHARS];
+		while (remaining >= minRemaining) {
+			// Only convert characters which start before the last minRemaining - 1 bytes
+			Uint startChars = std::min(std::min((remaining - minRemaining) / 4u + 1u, remaining / 4u), (Uint)CHUNK_CHARS);
+			Uint bufLen = 0;
+			Uint chars = convertChars(p, startChars, buf, bufLen);
+			dst.streamUtf8(buf, bufLen);
+			p += 4u * chars;
+			remaining -= 4u * chars;
+			if ((startChars != 0) && (chars == startChars)) {
+				continue;
+			}
+
+			std::pair<Uint, Char> out = convertChar(p, remaining);
+			ASSERT(out.first > 0);
+			ASSERT(out.first <= remaining);
+			p += out.first;
+			remaining -= out.first;
+			dst += out.second;
+		}
+		return srcLen - remaining;
+	}
+
+	// Converts up to count characters from src writing the UTF8 to dst (which
+	// must have room for 4 bytes per character) and adding its length to
+	// dstLen. Stops at the first invalid character. Returns the number of
+	// characters converted.
+	Uint convertChars(const char* src, Uint count, char* dst, Uint& dstLen) const {
+		Uint pos = 0;
+		while (pos < count) {
+#if BUILD(AVX2)
+			// 8 ASCII characters at a time
+			if (pos + 8u <= count) {
+				__m256i v = _mm256_loadu_si256((const __m256i*)(src + 4u * pos));
+				if (reverse_) {
+					v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+					v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xb1), 0xb1);
+				}
+				__m256i high = _mm256_and_si256(v, _mm256_set1_epi32((int)0xffffff80));
+				if ((Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(high, _mm256_setzero_si256())) == 0xffffffffu) {
+					__m256i words = _mm256_packs_epi32(v, v);
+					__m256i bytes = _mm256_packus_epi16(words, words);
+					Uint32 low = (Uint32)_mm_cvtsi128_si32(_mm256_castsi256_si128(bytes));
+					Uint32 upper = (Uint32)_mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1));
+					memcpy(dst + dstLen, &low, 4u);
+					memcpy(dst + dstLen + 4u, &upper, 4u);
+					dstLen += 8u;
+					pos += 8u;
+					continue;
+				}
+			}
+#endif
+#if BUILD(SSE2)
+			// 4 ASCII characters at a time
+			if (pos + 4u <= count) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(src + 4u * pos));
+				if (reverse_) {
+					v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+					v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+				}
+				__m128i high = _mm_and_si128(v, _mm_set1_epi32((int)0xffffff80));
+				if ((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xffffu) {
+					__m128i words = _mm_packs_epi32(v, v);
+					Uint32 bytes = (Uint32)_mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+					memcpy(dst + dstLen, &bytes, 4u);
+					dstLen += 4u;
+					pos += 4u;
+					continue;
+				}
+			}
+#endif
+			// One character at a time
+			Uint32 ch = getChar(src + 4u * pos);
+			if (((ch >= 0x0000d800u) && (ch < 0x0000e000u)) || (ch >= 0x00110000u)) {
+				return pos;
+			}
+			dstLen += Utf8Scan::encode(ch, dst + dstLen);
+			pos++;
+		}
+		return pos;
+	}
+
 private:
 	bool reverse_;
 };
@@ -1,6 +1,7 @@
 #pragma once
 #include <deque>
 #include "Util/Assert.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/CharOutputConverter.hpp"
 #include "Util/Def.hpp"
 
@@ -30,7 +31,30 @@ public:
 		return 4u;
 	}
 
+	bool convertAppendUtf8(const char* src, Uint len, std::string& dst) {
+		// Convert a block of characters at a time
+		char32_t words[BLOCK_WORDS];
+		Uint pos = 0;
+		while (pos < len) {
+			Uint count = 0;
+			for (; (count < BLOCK_WORDS) && (pos < len); count++) {
+				Uint charLen = 0;
+				Uint32 ch = Utf8Scan::decode(src + pos, charLen);
+				pos += charLen;
+				if (reverse_) {
+					ch = (ch >> 24) | ((ch >> 8) & 0xff00u) | ((ch << 8) & 0xff0000u) | (ch << 24);
+				}
+				words[count] = (char32_t)ch;
+			}
+			dst.append((const char*)words, 4 * count);
+		}
+		return true;
+	}
+
 private:
+	// The number of characters converted at a time
+	static const Uint BLOCK_WORDS = 256;
+
 	bool reverse_;
 };
 
@@ -1,8 +1,11 @@
 #pragma once
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/CharInputConverter.hpp"
 #include "Util/Def.hpp"
+#include "Util/String.hpp"
 
 // A character input converter from the UTF8 character encoding.
 class Utf8CharInputConverter : public CharInputConverter {
@@ -15,9 +18,9 @@ public:
 	std::pair<Uint, Char> convertChar(const char* src, Uint srcLen) {
 		ASSERT(srcLen > 0);
 		const char* psrc = src;
+		char buf[5];
 		if (srcLen <= 4u) {
 			// Pain but we need a separate buffer
-			char buf[5];
 			memcpy(buf, src, srcLen);
 			buf[srcLen] = '\0';
 			psrc = buf;
@@ -34,4 +37,44 @@ public:
 		}
 		return std::make_pair(len, ch);
 	}
+
+	// Bulk conversion. The source is already in the internal encoding so each
+	// run of valid UTF8 is appended directly to the destination in one go. Only
+	// invalid sequences and characters near the end of the buffer go through
+	// convertChar().
+	using CharInputConverter::convertAppend;
+	void convertAppend(const char* src, Uint srcLen, String& dst) {
+		convertRuns(src, srcLen, 1u, dst);
+	}
+
+	Uint convertAppendAvailable(const char* src, Uint srcLen, String& dst) {
+		return convertRuns(src, srcLen, MAX_INPUT_CHAR_BYTES, dst);
+	}
+
+private:
+	// Converts characters until fewer than minRemaining source bytes are left.
+	// Returns the number of source bytes consumed.
+	Uint convertRuns(const char* src, Uint srcLen, Uint minRemaining, String& dst) {
+		ASSERT(minRemaining > 0);
+		const char* p = src;
+		Uint remaining = srcLen;
+		while (remaining >= minRemaining) {
+			// Only scan characters which start before the last minRemaining - 1 bytes
+			Uint validLen = Utf8Scan::validPrefixLength(p, remaining - (minRemaining - 1));
+			dst.modifyUtf8().append(p, validLen);
+			p += validLen;
+			remaining -= validLen;
+			if (remaining < minRemaining) {
+				break;
+			}
+
+			std::pair<Uint, Char> out = convertChar(p, remaining);
+			ASSERT(out.first > 0);
+			ASSERT(out.first <= remaining);
+			p += out.first;
+			remaining -= out.first;
+			dst += out.second;
+		}
+		return srcLen - remaining;
+	}
 };
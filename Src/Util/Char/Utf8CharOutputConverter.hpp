@@ -17,4 +17,9 @@ public:
 	Uint convertChar(Char ch, char* dst) {
 		return ch.toUtf8(dst);
 	}
+
+	bool convertAppendUtf8(const char* src, Uint len, std::string& dst) {
+		dst.append(src, len);
+		return true;
+	}
 };
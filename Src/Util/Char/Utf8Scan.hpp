@@ -0,0 +1,282 @@
+#pragma once
+#include <cstring>
+#include "Util/Char.hpp"
+#include "Util/Def.hpp"
+
+#if BUILD(SSE2) || BUILD(AVX2)
+#include <immintrin.h>
+#endif
+#if BUILD(MSV)
+#include <intrin.h>
+#endif
+
+// Bulk scanning of UTF8 byte sequences. These are the fast paths used when
+// converting or comparing whole buffers rather than one character at a time.
+// Runs of ASCII bytes are handled 32 (AVX2), 16 (SSE2) or 8 (scalar) bytes at
+// a time and only the non-ASCII bytes are decoded individually.
+namespace Utf8Scan {
+
+	// Get the index of the lowest set bit in a non-zero mask.
+	inline Uint lowestSetBit(Uint32 mask) {
+#if BUILD(MSV)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (Uint)index;
+#elif BUILD(GNU)
+		return (Uint)__builtin_ctz(mask);
+#else
+#error "Illegal build"
+#endif
+	}
+
+	// Writes the 1 to 4 UTF8 bytes of the character ch (which must be valid
+	// UTF32) to utf8 which must have room for 4 bytes. Returns the number of
+	// bytes written. This is the same as Char::toUtf8() for use by the bulk
+	// converters which do not construct a Char for each character.
+	inline Uint encode(Uint32 ch, char* utf8) {
+		if (ch < 0x80u) {
+			utf8[0] = (char)ch;
+			return 1;
+		}
+		else if (ch < 0x0800u) {
+			utf8[0] = (char)(0xc0u + (ch >> 6));
+			utf8[1] = (char)(0x80u + (ch & 0x3fu));
+			return 2;
+		}
+		else if (ch < 0x00010000u) {
+			utf8[0] = (char)(0xe0u + (ch >> 12));
+			utf8[1] = (char)(0x80u + ((ch >> 6) & 0x3fu));
+			utf8[2] = (char)(0x80u + (ch & 0x3fu));
+			return 3;
+		}
+		else {
+			utf8[0] = (char)(0xf0u + (ch >> 18));
+			utf8[1] = (char)(0x80u + ((ch >> 12) & 0x3fu));
+			utf8[2] = (char)(0x80u + ((ch >> 6) & 0x3fu));
+			utf8[3] = (char)(0x80u + (ch & 0x3fu));
+			return 4;
+		}
+	}
+
+	// Reads the character at utf8 (which must be valid UTF8) returning it as
+	// UTF32 and setting len to the number of bytes read. This is the reverse
+	// of encode().
+	inline Uint32 decode(const char* utf8, Uint& len) {
+		Uint32 ch = (Uint8)utf8[0];
+		if (ch < 0x80u) {
+			len = 1;
+			return ch;
+		}
+
+		// The lead byte gives the length and the continuation bytes follow
+		len = (ch >= 0xf0u) ? 4u : (ch >= 0xe0u) ? 3u : 2u;
+		ch &= 0x7fu >> len;
+		for (Uint i = 1; i < len; i++) {
+			ch = (ch << 6) | ((Uint8)utf8[i] & 0x3fu);
+		}
+		return ch;
+	}
+
+	// Returns the number of bytes at the start of s (of length len) which
+	// are 7 bit ASCII.
+	inline Uint asciiPrefixLength(const char* s, Uint len) {
+		Uint pos = 0;
+#if BUILD(AVX2)
+		for (; pos + 32u <= len; pos += 32u) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(s + pos));
+			Uint32 mask = (Uint32)_mm256_movemask_epi8(v);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+#if BUILD(SSE2)
+		for (; pos + 16u <= len; pos += 16u) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(s + pos));
+			Uint32 mask = (Uint32)_mm_movemask_epi8(v);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+		for (; pos + 8u <= len; pos += 8u) {
+			Uint64 word;
+			memcpy(&word, s + pos, 8u);
+			if ((word & 0x8080808080808080ull) != 0) {
+				break;
+			}
+		}
+		for (; pos < len; pos++) {
+			if ((Uint8)s[pos] >= 0x80u) {
+				break;
+			}
+		}
+		return pos;
+	}
+
+	// Returns the number of bytes at the start of s (of length len) before the
+	// first carriage return or line feed (or len if there is neither). These
+	// are single bytes in UTF8 so this is safe on any valid UTF8 buffer.
+	inline Uint newlinePrefixLength(const char* s, Uint len) {
+		Uint pos = 0;
+#if BUILD(AVX2)
+		const __m256i cr32 = _mm256_set1_epi8('\r');
+		const __m256i lf32 = _mm256_set1_epi8('\n');
+		for (; pos + 32u <= len; pos += 32u) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(s + pos));
+			__m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(v, cr32), _mm256_cmpeq_epi8(v, lf32));
+			Uint32 mask = (Uint32)_mm256_movemask_epi8(eq);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+#if BUILD(SSE2)
+		const __m128i cr16 = _mm_set1_epi8('\r');
+		const __m128i lf16 = _mm_set1_epi8('\n');
+		for (; pos + 16u <= len; pos += 16u) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(s + pos));
+			__m128i eq = _mm_or_si128(_mm_cmpeq_epi8(v, cr16), _mm_cmpeq_epi8(v, lf16));
+			Uint32 mask = (Uint32)_mm_movemask_epi8(eq);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+		for (; pos < len; pos++) {
+			if ((s[pos] == '\r') || (s[pos] == '\n')) {
+				break;
+			}
+		}
+		return pos;
+	}
+
+	// Copies the ASCII bytes at the start of src (of length len) to dst
+	// converting the letters from first to first + 25 (i.e. 'a' to 'z' or 'A'
+	// to 'Z') to the other case. Returns the number of bytes copied which
+	// stops at the first non-ASCII byte. dst must have room for len bytes and
+	// bytes in dst beyond the returned length may be overwritten.
+	inline Uint asciiCaseCopy(const char* src, Uint len, char* dst, char first) {
+		Uint pos = 0;
+#if BUILD(AVX2)
+		const __m256i below32 = _mm256_set1_epi8((char)(first - 1));
+		const __m256i above32 = _mm256_set1_epi8((char)(first + 26));
+		const __m256i flip32 = _mm256_set1_epi8(0x20);
+		for (; pos + 32u <= len; pos += 32u) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(src + pos));
+			__m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(v, below32), _mm256_cmpgt_epi8(above32, v));
+			_mm256_storeu_si256((__m256i*)(dst + pos), _mm256_xor_si256(v, _mm256_and_si256(letter, flip32)));
+			Uint32 mask = (Uint32)_mm256_movemask_epi8(v);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+#if BUILD(SSE2)
+		const __m128i below16 = _mm_set1_epi8((char)(first - 1));
+		const __m128i above16 = _mm_set1_epi8((char)(first + 26));
+		const __m128i flip16 = _mm_set1_epi8(0x20);
+		for (; pos + 16u <= len; pos += 16u) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + pos));
+			__m128i letter = _mm_and_si128(_mm_cmpgt_epi8(v, below16), _mm_cmplt_epi8(v, above16));
+			_mm_storeu_si128((__m128i*)(dst + pos), _mm_xor_si128(v, _mm_and_si128(letter, flip16)));
+			Uint32 mask = (Uint32)_mm_movemask_epi8(v);
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+		for (; pos < len; pos++) {
+			char ch = src[pos];
+			if ((Uint8)ch >= 0x80u) {
+				break;
+			}
+			dst[pos] = ((ch >= first) && (ch < first + 26)) ? (char)(ch ^ 0x20) : ch;
+		}
+		return pos;
+	}
+
+	// Returns the number of bytes at the start of a and b (both of length at
+	// least len) which are ASCII and equal apart from the case of letters.
+	inline Uint asciiCaselessPrefixLength(const char* a, const char* b, Uint len) {
+		Uint pos = 0;
+#if BUILD(AVX2)
+		const __m256i below32 = _mm256_set1_epi8('A' - 1);
+		const __m256i above32 = _mm256_set1_epi8('Z' + 1);
+		const __m256i flip32 = _mm256_set1_epi8(0x20);
+		for (; pos + 32u <= len; pos += 32u) {
+			__m256i va = _mm256_loadu_si256((const __m256i*)(a + pos));
+			__m256i vb = _mm256_loadu_si256((const __m256i*)(b + pos));
+			__m256i upperA = _mm256_and_si256(_mm256_cmpgt_epi8(va, below32), _mm256_cmpgt_epi8(above32, va));
+			__m256i upperB = _mm256_and_si256(_mm256_cmpgt_epi8(vb, below32), _mm256_cmpgt_epi8(above32, vb));
+			__m256i la = _mm256_xor_si256(va, _mm256_and_si256(upperA, flip32));
+			__m256i lb = _mm256_xor_si256(vb, _mm256_and_si256(upperB, flip32));
+			Uint32 differ = ~(Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(la, lb));
+			Uint32 mask = differ | (Uint32)_mm256_movemask_epi8(_mm256_or_si256(va, vb));
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+#if BUILD(SSE2)
+		const __m128i below16 = _mm_set1_epi8('A' - 1);
+		const __m128i above16 = _mm_set1_epi8('Z' + 1);
+		const __m128i flip16 = _mm_set1_epi8(0x20);
+		for (; pos + 16u <= len; pos += 16u) {
+			__m128i va = _mm_loadu_si128((const __m128i*)(a + pos));
+			__m128i vb = _mm_loadu_si128((const __m128i*)(b + pos));
+			__m128i upperA = _mm_and_si128(_mm_cmpgt_epi8(va, below16), _mm_cmplt_epi8(va, above16));
+			__m128i upperB = _mm_and_si128(_mm_cmpgt_epi8(vb, below16), _mm_cmplt_epi8(vb, above16));
+			__m128i la = _mm_xor_si128(va, _mm_and_si128(upperA, flip16));
+			__m128i lb = _mm_xor_si128(vb, _mm_and_si128(upperB, flip16));
+			Uint32 differ = ~(Uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(la, lb)) & 0xffffu;
+			Uint32 mask = differ | (Uint32)_mm_movemask_epi8(_mm_or_si128(va, vb));
+			if (mask != 0) {
+				return pos + lowestSetBit(mask);
+			}
+		}
+#endif
+		for (; pos < len; pos++) {
+			char ca = a[pos];
+			char cb = b[pos];
+			if ((Uint8)(ca | cb) >= 0x80u) {
+				break;
+			}
+			if (ca != cb) {
+				if ((ca >= 'A') && (ca <= 'Z')) {
+					ca = (char)(ca ^ 0x20);
+				}
+				if ((cb >= 'A') && (cb <= 'Z')) {
+					cb = (char)(cb ^ 0x20);
+				}
+				if (ca != cb) {
+					break;
+				}
+			}
+		}
+		return pos;
+	}
+
+	// Returns the number of bytes at the start of s (of length len) which
+	// form complete and valid UTF8 characters. Scanning stops at the first
+	// invalid byte sequence or at a character which may be truncated by the
+	// end of the buffer (i.e. a non-ASCII character within 4 bytes of the end).
+	// These remaining bytes must be handled one character at a time.
+	inline Uint validPrefixLength(const char* s, Uint len) {
+		Uint pos = 0;
+		for (;;) {
+			pos += asciiPrefixLength(s + pos, len - pos);
+			if (len - pos < 4u) {
+				// Either the end or we cannot safely call Char::fromUtf8()
+				// which may look up to 4 bytes ahead.
+				return pos;
+			}
+			Uint charLen = 0;
+			Char ch = Char::fromUtf8(s + pos, charLen);
+			if (ch.isEof()) {
+				return pos;
+			}
+			pos += charLen;
+		}
+	}
+}
@@ -40,6 +40,11 @@ public:
 	// Constructor from an ordinal
 	CharEncoding(Ordinal ordinal = INVALID);
 
+	// Detect a Unicode byte order mark at the start of data which has size
+	// bytes. Returns the encoding and sets bomSize to the size of the BOM.
+	// If there is no BOM returns INVALID and sets bomSize to 0.
+	static CharEncoding fromBom(const char* data, Uint size, Uint& bomSize);
+
 	// Returns true if the encoding is valid (i.e. not invalid).
 	bool isValid() const;
 
@@ -56,9 +56,20 @@ public:
 	// character is inserted into the output string as appropriate. The entire source
 	// buffer must be used up: any partial character at the end is treated as an error.
 	// The converted output is appended on to the supplied string.
-	void convertAppend(const char* src, Uint srcLen, String& dst);
+	// The default implementation calls convertChar() for each character. Converters
+	// which can convert in bulk override this.
+	virtual void convertAppend(const char* src, Uint srcLen, String& dst);
 	void convertAppend(const std::string& src, String& dst);
 
+	// Converts as many characters as can safely be converted from the start of the
+	// source buffer src of length srcLen, i.e. stops once fewer than MAX_INPUT_CHAR_BYTES
+	// bytes remain since the next character may be incomplete. This is for streaming
+	// input where more data will follow. Errors are handled as for convertChar().
+	// The converted output is appended on to the supplied string.
+	// Returns the number of source bytes consumed.
+	// The default implementation calls convertChar() for each character.
+	virtual Uint convertAppendAvailable(const char* src, Uint srcLen, String& dst);
+
 	// Convenience method as above which returns the destination string.
 	String convertString(const char* src, Uint srcLen);
 	String convertString(const std::string& src);
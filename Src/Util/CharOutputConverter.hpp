@@ -41,6 +41,13 @@ public:
 	// output encoding.
 	virtual Uint convertChar(Char ch, char* dst) = 0;
 
+	// Converts the valid UTF8 string src of length len and appends it on to the
+	// supplied std::string. Returns true on success or false if there was one or
+	// more encoding errors. Characters which cannot be encoded are skipped. By
+	// default each character is converted with convertChar() but converters
+	// override this to convert the whole string in bulk.
+	virtual bool convertAppendUtf8(const char* src, Uint len, std::string& dst);
+
 	// Convenience method which converts the whole of the source string and appends
 	// it on to the supplied std::string. Returns true on success or false if there
 	// was one or more encoding errors. Characters which cannot be encoded are skipped.
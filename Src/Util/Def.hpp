@@ -99,6 +99,22 @@
 	#error "Illegal OS"
 #endif
 
+// Vector instruction set extensions which the compiler may assume:
+// #if BUILD(SSE2)		// SSE2 (always available for 64 bit builds)
+// #if BUILD(AVX2)		// AVX2 (MSV /arch:AVX2 or Gnu -mavx2)
+#define _BUILD_SSE2_VALID_ 1
+#define _BUILD_AVX2_VALID_ 1
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define BUILD_SSE2 1
+#else
+	#define BUILD_SSE2 0
+#endif
+#if defined(__AVX2__)
+	#define BUILD_AVX2 1
+#else
+	#define BUILD_AVX2 0
+#endif
+
 // Build directory name
 // path = .../BUILD_DIRECTORY/...
 #if BUILD(MSV) && BUILD(32_BIT) && BUILD(DEBUG)
@@ -6,6 +6,7 @@
 #include <vector>
 #include "Util/Char.hpp"
 #include "Util/CharEncoding.hpp"
+#include "Util/CharOutputConverter.hpp"
 #include "Util/Def.hpp"
 #include "Util/String.hpp"
 
@@ -119,6 +120,11 @@ public:
 	// Test whether the path is valid AND exists AND is a file.
 	bool exists() const;
 
+	// Get the size in bytes and the last modification time of the file.
+	// The time units depend on the file system so times should only be
+	// compared with each other. Returns false if the file does not exist.
+	bool getStatus(Uint64& size, Int64& modifiedTime) const;
+
 	// Get the parent directory of the file or DirPath()
 	// if there is an error.
 	DirPath getParentDir() const;
@@ -142,6 +148,7 @@ private:
 	// Constructor which performs no checking on the path.
 	// The bool argument is to discriminate from the other constructor above.
 	friend class FileSystemPlatform;
+	friend class FileSystemVirtual;
 	FilePath(bool, const String& path);
 
 private:
@@ -153,7 +160,9 @@ private:
 // suitable handler by calling "set" and then can retrieve this handler
 // globally by calling "get". There is an underlying singleton object.
 // If no error handler is set, or if it is set to null then a default
-// error handler ignores all file system errors.
+// error handler ignores all file system errors. "set" and "get" may be
+// called from any thread. The one handler is used by all threads so its
+// functions must be thread safe if files are used by several threads.
 class FileSystemErrorHandler {
 public:
 	// Set the file system error handler. Calling with a 0 argument
@@ -203,18 +212,32 @@ private:
 	// Constructor.
 	// charEncoding is ignored if the file begins with a Unicode BOM. Otherwise
 	// it determines the encoding of the file.
+	// bufferSize is the size of the internal input buffer. See open().
 	// An error is reported:
 	// (1) If the file could not be opened
 	// (2) If there is an IO error reading the file
 	// (3) If the file has a character which is illegal
 	// In the first 2 cases the file is closed and all future reads will return EOFs.
 	// For (3) the illegal character will be replaced with a space character.
-	FileEncodedInput(const CharEncoding& charEncoding, const FilePath& absFilePath);
+	FileEncodedInput(const CharEncoding& charEncoding, const FilePath& absFilePath, Uint bufferSize);
 	ALLOW_MAKE_SHARED(FileEncodedInput);
 
 public:
-	// Create an object
-	static FileEncodedInputPtr open(const CharEncoding& charEncoding, const FilePath& absFilePath);
+	// Input buffer sizes for open(). The buffer is allocated on the heap.
+	// With ADAPTIVE_BUFFER_SIZE the buffer starts at MIN_BUFFER_SIZE and doubles
+	// each time it is refilled up to MAX_BUFFER_SIZE, so small files stay cheap
+	// and large files need few reads.
+	static const Uint DEFAULT_BUFFER_SIZE = 64 * 1024;
+	static const Uint ADAPTIVE_BUFFER_SIZE = 0;
+	static const Uint MIN_BUFFER_SIZE = 4 * 1024;
+	static const Uint MAX_BUFFER_SIZE = 1024 * 1024;
+
+	// Create an object. bufferSize is ADAPTIVE_BUFFER_SIZE or a size in bytes
+	// which must be at least CharInputConverter::MAX_INPUT_CHAR_BYTES.
+	static FileEncodedInputPtr open(
+		const CharEncoding& charEncoding, 
+		const FilePath& absFilePath, 
+		Uint bufferSize = DEFAULT_BUFFER_SIZE);
 
 	// Destructor.
 	~FileEncodedInput();
@@ -240,22 +263,59 @@ public:
 	// Stops reading if the end of file is reached.
 	String readString(Uint size = std::numeric_limits<Uint>::max());
 
+	// Read the rest of the current line, including the terminating '\n' if there
+	// is one, and append to the supplied string. Line endings are converted as
+	// for read(). Afterwards getLine() returns the line number of the line read.
+	// Returns false (and appends nothing) at the end of the file.
+	bool readLine(String& dst);
+
+	// Read a block of decoded characters and append to the supplied string. This
+	// is the fastest way to read a whole file since the input is converted a
+	// buffer at a time. Appends at most maxBytes bytes (of UTF8) but always whole
+	// characters and always at least one character unless at the end of the file.
+	// Line endings are converted as for read(). Afterwards getLine() returns the
+	// line number of the last character read.
+	// Returns the number of bytes appended, 0 at the end of the file.
+	Uint readChunk(String& dst, Uint maxBytes = std::numeric_limits<Uint>::max());
+
 	// Get the actual character encoding of the file. This may be different
 	// from the encoding supplied at creation if the file has a BOM.
 	CharEncoding getCharEncoding() const;
 
+private:
+	friend class InputFileCharInputConverterErrorHandler;
+
+	// Make sure there is unread decoded text, decoding more input if necessary.
+	// Returns false at the end of the file or if IO has failed.
+	bool fillText();
+
+	// Convert the line endings in newly decoded text to '\n'.
+	void convertNewlines();
+
+	// Move len bytes of unread decoded text to dst and update the line number.
+	void take(String& dst, Uint len);
+
+	// Get the line number of the next character to be decoded. Used for errors.
+	Line getDecodeLine() const;
+
 private:
 	CharEncoding charEncoding_;			// Character encoding
 	FilePath absFilePath_;				// File path
 	FileRawInputPtr in_;				// Raw input
 	CharInputConverterPtr converter_;	// Converter
 	Line line_;							// Current line number
-	Char newLineChar_;					// Set to last out character if it starts a new line
-										// and has been replaced with \n. \0 otherwise.
-	static const Uint BUF_SIZE = 1024;	// Internal buffer size
-	char buf_[BUF_SIZE];				// Internal buffer
-	Uint size_;							// Size of data in internal buffer. If 0 at EOF.
-	Uint pos_;							// Position in buffer
+	bool lineEnded_;					// True if the last character read was '\n'
+	Char newLineChar_;					// Set to the last decoded character if it started a
+										// new line and was replaced with \n. \0 otherwise.
+	std::unique_ptr<char[]> buf_;		// Internal buffer. Not used for a view of the whole file.
+	Uint bufSize_;						// Internal buffer size
+	bool adaptive_;						// True to grow the buffer when refilled
+	const char* data_;					// The input data: buf_ or a view of the whole file
+	Uint size_;							// Size of the input data
+	Uint pos_;							// Position in the input data
+	bool inputEnded_;					// True once the raw input has been read to the end
+	String text_;						// Decoded text with newlines converted
+	Uint textPos_;						// Position of the next unread byte in text_
 }; 
 
 // A binary file open for input.
@@ -286,6 +346,23 @@ public:
 	// Read up to "size" bytes and return as a std::string.
 	std::string readString(Uint size = std::numeric_limits<Uint>::max());
 
+	// Zero copy read. If the file is held in memory (e.g. a large platform
+	// file which is memory mapped) sets data to point to up to "size" unread
+	// bytes, marks them as read and sets size to the number of bytes (0 at the
+	// end of file). The bytes remain valid for the lifetime of this object.
+	// Returns false, reading nothing, if not supported. Use read() instead.
+	bool view(const char*& data, Uint& size);
+
+	// Move the read position to "pos" bytes from the start of the file.
+	// Returns false, leaving the position unchanged, if pos is beyond the end
+	// of the file.
+	bool seek(Uint pos);
+
+	// Positioned read. Read up to "size" bytes starting at position "pos"
+	// into the supplied buffer without changing the read position. Returns
+	// the number of bytes read (0 at or beyond the end of file).
+	Uint readAt(char* dst, Uint pos, Uint size);
+
 private:
 	FilePath absFilePath_;
 	FileRawInputPtr in_;
@@ -296,21 +373,36 @@ private:
 // for the platform and then the internal UTF32 is converted according to the
 // output character encoding. Characters which cannot be encoded in the output
 // encoding are skipped and an error is output.
+//
+// The encoded output is collected in an internal buffer which is only written
+// to the file when it is full, on flush() and on close(). So an error writing
+// the file may not be reported until then.
 class FileEncodedOutput  : public OutputStream {
 private:
 	// Constructor.
-	FileEncodedOutput(const CharEncoding& charEncoding, const FilePath& absFilePath);
+	// bufferSize is the size of the internal output buffer. See create().
+	FileEncodedOutput(const CharEncoding& charEncoding, const FilePath& absFilePath, Uint bufferSize);
 	ALLOW_MAKE_SHARED(FileEncodedOutput);
 
 public:
-	// Create an object
-	static FileEncodedOutputPtr create(const CharEncoding& charEncoding, const FilePath& absFilePath);
+	// Output buffer sizes for create(). The buffer is allocated on the heap.
+	static const Uint DEFAULT_BUFFER_SIZE = 64 * 1024;
+	static const Uint MIN_BUFFER_SIZE = 2 * CharOutputConverter::MAX_OUTPUT_CHAR_BYTES;
+
+	// Create an object. bufferSize is a size in bytes which must be at
+	// least MIN_BUFFER_SIZE.
+	static FileEncodedOutputPtr create(
+		const CharEncoding& charEncoding, 
+		const FilePath& absFilePath, 
+		Uint bufferSize = DEFAULT_BUFFER_SIZE);
 
 	// Destructor. Closes the file if it is not closed already.
 	~FileEncodedOutput();
 	
-	// OutputStream virtual method
+	// OutputStream virtual methods
 	void streamChar(Char ch) { write(ch); }
+	void streamUtf8(const char* s, Uint len);
+	void flush();
 
 	// Write the supplied character.
 	void write(Char src);
@@ -319,19 +411,35 @@ public:
 	// Write the supplied string.
 	void write(const String& src);
 
-	// Close the output file
+	// Write out the buffer and close the output file
 	void close(); 
 
 	// Returns true if one or more errors has been reported.
 	// These can be either IO errors or encoding errors.
 	bool hasReportedErrors() const;
 
+private:
+	// Add bytes which are already encoded to the buffer, writing out the
+	// buffer as it fills.
+	void bufferBytes(const char* src, Uint size);
+
+	// Encode the valid UTF8 string src of length len in bulk and add it to
+	// the buffer. Newlines are not expanded for the platform.
+	void bufferUtf8(const char* src, Uint len);
+
+	// Write out the buffer to the file.
+	void writeBuffer();
+
 private:
 	CharEncoding charEncoding_;
 	FilePath absFilePath_;
 	FileRawOutputPtr out_;
 	CharOutputConverterPtr converter_;
 	bool encodingErrorReported_;
+	std::unique_ptr<char[]> buf_;	// The output buffer (null if the file could not be opened)
+	Uint bufSize_;					// The size of buf_
+	Uint used_;						// The number of bytes in buf_ not yet written
+	std::string encoded_;			// Text encoded by bufferUtf8() (kept to reuse its capacity)
 };
 
 // A binary file open for output.
@@ -383,6 +491,22 @@ namespace FileSystem {
 	// and files beginning with $ are handled just like any others.
 	void stopVirtualFileSystem();
 
+	// Select the virtual file system namespace used by the calling thread.
+	// Each namespace is a separate virtual file system which is started,
+	// stopped and holds its files independently of the others. So test cases
+	// run in parallel can each use their own. A thread uses namespace 0 until
+	// it selects another.
+	void setVirtualNamespace(Uint ns);
+
+	// Get the virtual file system namespace used by the calling thread.
+	Uint getVirtualNamespace();
+
+	// Enable or disable memory mapping of large platform files for input
+	// (see FileBinaryInput::view()). It is enabled by default. With it
+	// disabled every platform file is read through the input buffer, so for
+	// example a benchmark can measure the effect of the buffer size.
+	void setMemoryMapping(bool enable);
+
 	// Get the separator used between path elements i.e. \ in Windows or / in Linux.
 	const String& getPathSeparator();
 
@@ -38,6 +38,14 @@ Uint FileBinaryInput::read(char* dst, Uint size) {
 }
 
 void FileBinaryInput::read(std::string& dst, Uint size) {
+	// Copy straight from the file contents if possible
+	const char* data;
+	Uint viewSize = size;
+	if (view(data, viewSize)) {
+		dst.append(data, viewSize);
+		return;
+	}
+
 	Uint remaining = size;
 	const Uint BUF_SIZE = 1024;
 	char buf[BUF_SIZE];
@@ -57,3 +65,28 @@ std::string FileBinaryInput::readString(Uint size) {
 	return ret;
 }
 
+bool FileBinaryInput::view(const char*& data, Uint& size) {
+	if (in_->failed()) {
+		return false;
+	}
+	return in_->view(data, size);
+}
+
+bool FileBinaryInput::seek(Uint pos) {
+	if (in_->failed()) {
+		return false;
+	}
+	return in_->seek(pos);
+}
+
+Uint FileBinaryInput::readAt(char* dst, Uint pos, Uint size) {
+	if (in_->failed() || !in_->readAt(dst, pos, size)) {
+		return 0;
+	}
+	if (in_->failed()) {
+		FileSystemErrorHandler::get()->readError(absFilePath_);
+		return 0;
+	}
+	return size;
+}
+
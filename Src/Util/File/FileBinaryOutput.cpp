@@ -39,10 +39,7 @@ void FileBinaryOutput::write(const char* src, Uint size) {
 }
 
 void FileBinaryOutput::write(const std::string& src) {
-	for (Uint pos = 0; pos < src.size(); pos++) {
-		char ch = src[pos];
-		write(&ch, 1);
-	}
+	write(src.data(), (Uint)src.size());
 }
 
 void FileBinaryOutput::close() {
@@ -1,7 +1,10 @@
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/CharInputConverter.hpp"
 #include "Util/Def.hpp"
 #include "Util/File.hpp"
@@ -18,42 +21,50 @@
 class InputFileCharInputConverterErrorHandler : public CharInputConverterErrorHandler {
 public:
 	// Create the error handler.
-	static CharInputConverterErrorHandlerPtr create(const Line* line) {
-		return std::make_shared<InputFileCharInputConverterErrorHandler>(line);
+	static CharInputConverterErrorHandlerPtr create(const FileEncodedInput* input) {
+		return std::make_shared<InputFileCharInputConverterErrorHandler>(input);
 	}
 
 	~InputFileCharInputConverterErrorHandler() {
 	}
 
 	void cannotEncodeForInput(const std::string& hexSequence) {
-		FileSystemErrorHandler::get()->cannotEncodeForInput(*line_, hexSequence);
+		FileSystemErrorHandler::get()->cannotEncodeForInput(input_->getDecodeLine(), hexSequence);
 	}
 private:
-	InputFileCharInputConverterErrorHandler(const Line* line) :
-		line_(line)
+	InputFileCharInputConverterErrorHandler(const FileEncodedInput* input) :
+		input_(input)
 	{ 
 	}
 	ALLOW_MAKE_SHARED(InputFileCharInputConverterErrorHandler);
 private:
-	const Line* line_;
+	const FileEncodedInput* input_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // FileEncodedInput
 ///////////////////////////////////////////////////////////////////////////////
 
-FileEncodedInput::FileEncodedInput(const CharEncoding& charEncoding, const FilePath& absFilePath) :
+FileEncodedInput::FileEncodedInput(const CharEncoding& charEncoding, const FilePath& absFilePath, Uint bufferSize) :
 	charEncoding_(charEncoding),
 	absFilePath_(absFilePath),
 	in_(),
 	converter_(),
 	line_(1),
+	lineEnded_(false),
 	newLineChar_('\0'),
-	// buf_,
+	buf_(),
+	bufSize_(bufferSize == ADAPTIVE_BUFFER_SIZE ? (Uint)MIN_BUFFER_SIZE : bufferSize),
+	adaptive_(bufferSize == ADAPTIVE_BUFFER_SIZE),
+	data_(nullptr),
 	size_(0),
-	pos_(0)
+	pos_(0),
+	inputEnded_(false),
+	text_(),
+	textPos_(0)
 {
 	ASSERT(charEncoding_.isValid());
+	ASSERT(bufSize_ >= CharInputConverter::MAX_INPUT_CHAR_BYTES);
 
 	in_ = absFilePath.isVirtual() ? FileSystemVirtual::instance()->openForInput(absFilePath)
 								  : FileSystemPlatform::instance()->openForInput(absFilePath);
@@ -62,65 +73,49 @@ FileEncodedInput::FileEncodedInput(const CharEncoding& charEncoding, const FileP
 		return;
 	}
 
-	size_ = in_->read(buf_, BUF_SIZE);
-	if (in_->failed()) {
-		FileSystemErrorHandler::get()->readError(absFilePath_);
-		return;
+	// Work directly on the file contents if they are in memory
+	Uint viewSize = std::numeric_limits<Uint>::max();
+	if (in_->view(data_, viewSize)) {
+		size_ = viewSize;
+		inputEnded_ = true;
+		if (adaptive_) {
+			// Nothing to grow so decode in the largest blocks
+			bufSize_ = MAX_BUFFER_SIZE;
+		}
+	}
+	else {
+		buf_.reset(new char[bufSize_]);
+		data_ = buf_.get();
+		size_ = in_->read(buf_.get(), bufSize_);
+		if (in_->failed()) {
+			FileSystemErrorHandler::get()->readError(absFilePath_);
+			return;
+		}
 	}
 
 	// Look for BOM
-	if ((size_ >= 3) &&
-		(buf_[0] == (char)0xef) &&
-		(buf_[1] == (char)0xbb) &&
-		(buf_[2] == (char)0xbf))
-	{
-		charEncoding_ = CharEncoding::UTF8;
-		pos_ = 3;
-	}
-	else if ((size_ >= 4) &&
-		(buf_[0] == (char)0x00) &&
-		(buf_[1] == (char)0x00) &&
-		(buf_[2] == (char)0xfe) &&
-		(buf_[3] == (char)0xff))
-	{
-		charEncoding_ = CharEncoding::UTF32BE;
-		pos_ = 4;
-	}
-	else if ((size_ >= 4) &&
-		(buf_[0] == (char)0xff) &&
-		(buf_[1] == (char)0xfe) &&
-		(buf_[2] == (char)0x00) &&
-		(buf_[3] == (char)0x00))
-	{
-		charEncoding_ = CharEncoding::UTF32LE;
-		pos_ = 4;
-	}
-	else if ((size_ >= 2) &&
-		(buf_[0] == (char)0xfe) &&
-		(buf_[1] == (char)0xff))
-	{
-		charEncoding_ = CharEncoding::UTF16BE;
-		pos_ = 2;
-	}
-	else if ((size_ >= 2) &&
-		(buf_[0] == (char)0xff) &&
-		(buf_[1] == (char)0xfe))
-	{
-		charEncoding_ = CharEncoding::UTF16LE;
-		pos_ = 2;
+	Uint bomSize;
+	CharEncoding bomEncoding = CharEncoding::fromBom(data_, size_, bomSize);
+	if (bomEncoding.isValid()) {
+		charEncoding_ = bomEncoding;
+		pos_ = bomSize;
 	}
 
 	converter_ = CharInputConverter::create(
 		charEncoding_, 
-		InputFileCharInputConverterErrorHandler::create(&line_), 
+		InputFileCharInputConverterErrorHandler::create(this), 
 		Char(' '));
 }
 
 FileEncodedInput::~FileEncodedInput() {
 }
 
-FileEncodedInputPtr FileEncodedInput::open(const CharEncoding& charEncoding, const FilePath& absFilePath) {
-	return std::make_shared<FileEncodedInput>(charEncoding, absFilePath);
+FileEncodedInputPtr FileEncodedInput::open(
+	const CharEncoding& charEncoding, 
+	const FilePath& absFilePath, 
+	Uint bufferSize) 
+{
+	return std::make_shared<FileEncodedInput>(charEncoding, absFilePath, bufferSize);
 }
 
 Line FileEncodedInput::getLine() const {
@@ -128,91 +123,235 @@ Line FileEncodedInput::getLine() const {
 }
 
 Char FileEncodedInput::read() {
-	// Return if already at EOF or if IO has failed.
-	if ((size_ == 0) || in_->failed()) {
+	if (!fillText()) {
 		return Char::eof();
 	}
 
 	// Increment the line number for the character after a newline
-	if (newLineChar_ != '\0') {
+	if (lineEnded_) {
 		line_++;
 	}
 
-	if (size_ - pos_ < CharInputConverter::MAX_INPUT_CHAR_BYTES) {
-		// We do not have enough data in the converter.
-		memmove(buf_, buf_ + pos_, size_ - pos_);
-		size_ -= pos_;
-		pos_ = 0;
-
-		// Try to read in more data from file
-		Uint toRead = BUF_SIZE - size_; 
-		Uint readSize = in_->read(buf_ + size_, toRead);
-		ASSERT(readSize <= toRead);
-		size_ += readSize;
+	Uint len;
+	Char ch = Char::fromUtf8(text_.str_.c_str() + textPos_, len);
+	ASSERT(!ch.isEof());
+	textPos_ += len;
+	lineEnded_ = (ch == '\n');
+	return ch;
+}
 
-		if (in_->failed()) {		
-			FileSystemErrorHandler::get()->readError(absFilePath_);
-			return Char::eof();
+Uint FileEncodedInput::read(String& dst, Uint size) {
+	Uint ret = 0;
+	while ((ret < size) && fillText()) {
+		// Take as many whole characters as are wanted from the decoded text
+		const char* p = text_.str_.data() + textPos_;
+		Uint avail = (Uint)text_.str_.size() - textPos_;
+		Uint len = 0;
+		while ((len < avail) && (ret < size)) {
+			len++;
+			while ((len < avail) && (((Uint8)p[len] & 0xc0) == 0x80)) {
+				len++;
+			}
+			ret++;
 		}
+		take(dst, len);
 	}
+	return ret;
+}
 
-	if (pos_ == size_) {
-		// No more characters
-		newLineChar_ == '\0';
-		size_ = 0;
-		return Char::eof();
-	}
+String FileEncodedInput::readString(Uint size) {
+	String ret;
+	read(ret, size);
+	return ret;
+}
 
-	// Convert one character
-	std::pair<Uint, Char> out = converter_->convertChar(buf_ + pos_, size_ - pos_);
-	ASSERT(out.first > 0);
-	ASSERT(pos_ + out.first <= size_);
-	pos_ += out.first;
+CharEncoding FileEncodedInput::getCharEncoding() const {
+	return charEncoding_;
+}
 
-	Char ch = out.second;
+bool FileEncodedInput::readLine(String& dst) {
+	if (!fillText()) {
+		return false;
+	}
 
-	if (newLineChar_ == '\r') {
-		// \r\n is a single newline
-		newLineChar_ = '\0';
-		if (ch == '\n') {
-			return read();
+	do {
+		const char* p = text_.str_.data() + textPos_;
+		Uint avail = (Uint)text_.str_.size() - textPos_;
+		const char* newline = (const char*)memchr(p, '\n', avail);
+		if (newline != nullptr) {
+			take(dst, (Uint)(newline - p) + 1);
+			return true;
 		}
+		take(dst, avail);
+	} while (fillText());
+	return true;
+}
+
+Uint FileEncodedInput::readChunk(String& dst, Uint maxBytes) {
+	if (!fillText()) {
+		return 0;
 	}
-	else if (newLineChar_ == '\n') {
-		// \n\r is a single newline
-		newLineChar_ = '\0';
-		if (ch == '\r') {
-			return read();
-		}
+
+	const std::string& text = text_.str_;
+	Uint avail = (Uint)text.size() - textPos_;
+	Uint len = std::min(avail, maxBytes);
+
+	// Don't split a character
+	while ((len > 0) && (len < avail) && (((Uint8)text[textPos_ + len] & 0xc0) == 0x80)) {
+		len--;
 	}
+	if (len == 0) {
+		Char::fromUtf8(text.c_str() + textPos_, len);
+	}
+
+	take(dst, len);
+	return len;
+}
 
-	// Detect the start of a new newline and return \n if so.
-	if ((ch == '\n') || (ch == '\r')) {
-		newLineChar_ = ch;
-		ch = '\n';
+bool FileEncodedInput::fillText() {
+	if (textPos_ < text_.str_.size()) {
+		return true;
 	}
+	text_.clear();
+	textPos_ = 0;
 
-	return ch;
+	// Return if IO has failed.
+	if (in_->failed()) {
+		return false;
+	}
+
+	for (;;) {
+		if (!inputEnded_ && (size_ - pos_ < CharInputConverter::MAX_INPUT_CHAR_BYTES)) {
+			// We do not have enough data in the converter.
+			if (adaptive_ && (bufSize_ < MAX_BUFFER_SIZE)) {
+				// Move the remaining data into a bigger buffer
+				Uint newSize = std::min(bufSize_ * 2, (Uint)MAX_BUFFER_SIZE);
+				std::unique_ptr<char[]> newBuf(new char[newSize]);
+				memcpy(newBuf.get(), buf_.get() + pos_, size_ - pos_);
+				buf_ = std::move(newBuf);
+				bufSize_ = newSize;
+				data_ = buf_.get();
+			}
+			else {
+				memmove(buf_.get(), buf_.get() + pos_, size_ - pos_);
+			}
+			size_ -= pos_;
+			pos_ = 0;
+
+			// Try to read in more data from file
+			Uint toRead = bufSize_ - size_; 
+			Uint readSize = in_->read(buf_.get() + size_, toRead);
+			ASSERT(readSize <= toRead);
+			size_ += readSize;
+
+			if (in_->failed()) {		
+				FileSystemErrorHandler::get()->readError(absFilePath_);
+				return false;
+			}
+			if (readSize == 0) {
+				inputEnded_ = true;
+			}
+		}
+
+		if (pos_ == size_) {
+			// No more characters. The EOF is on the line after a final newline.
+			if (lineEnded_) {
+				line_++;
+				lineEnded_ = false;
+			}
+			return false;
+		}
+
+		// Convert a buffer full of characters
+		Uint avail = size_ - pos_;
+		if (inputEnded_ && (avail <= bufSize_)) {
+			converter_->convertAppend(data_ + pos_, avail, text_);
+			pos_ = size_;
+		}
+		else {
+			pos_ += converter_->convertAppendAvailable(data_ + pos_, std::min(avail, bufSize_), text_);
+			ASSERT(pos_ <= size_);
+		}
+		convertNewlines();
+
+		if (!text_.str_.empty()) {
+			return true;
+		}
+	}
 }
 
-Uint FileEncodedInput::read(String& dst, Uint size) {
-	Uint ret = 0;
-	for (ret = 0; ret < size; ret++) {
-		Char ch = read();
-		if (ch.isEof()) {
-			break;
+void FileEncodedInput::convertNewlines() {
+	std::string& text = text_.modifyUtf8();
+	Uint size = (Uint)text.size();
+	Uint in = 0;
+	Uint out = 0;
+	while (in < size) {
+		if (newLineChar_ != '\0') {
+			// \r\n and \n\r are single newlines
+			char ch = text[in];
+			bool pair = ((newLineChar_ == '\r') && (ch == '\n')) || ((newLineChar_ == '\n') && (ch == '\r'));
+			newLineChar_ = '\0';
+			if (pair) {
+				in++;
+				continue;
+			}
+		}
+
+		// Copy up to the next newline. Nothing moves until a newline has been dropped.
+		Uint len = Utf8Scan::newlinePrefixLength(text.data() + in, size - in);
+		if (out != in) {
+			memmove(&text[out], &text[in], len);
+		}
+		in += len;
+		out += len;
+
+		if (in < size) {
+			newLineChar_ = text[in];
+			text[out] = '\n';
+			in++;
+			out++;
 		}
-		dst += ch;
 	}
-	return ret;
+	text.resize(out);
 }
 
-String FileEncodedInput::readString(Uint size) {
-	String ret;
-	read(ret, size);
-	return ret;
+void FileEncodedInput::take(String& dst, Uint len) {
+	ASSERT(len > 0);
+	ASSERT(textPos_ + len <= text_.str_.size());
+	const char* p = text_.str_.data() + textPos_;
+
+	// Increment the line number for the character after a newline
+	if (lineEnded_) {
+		line_++;
+	}
+	Uint newlines = (Uint)std::count(p, p + len, '\n');
+	lineEnded_ = (p[len - 1] == '\n');
+	line_ += (Line)(lineEnded_ ? newlines - 1 : newlines);
+
+	dst.modifyUtf8().append(p, len);
+	textPos_ += len;
 }
 
-CharEncoding FileEncodedInput::getCharEncoding() const {
-	return charEncoding_;
+Line FileEncodedInput::getDecodeLine() const {
+	// Only called during conversion when text_ holds the decoded text so far
+	// for the current buffer, with the line endings not yet converted.
+	Line line = lineEnded_ ? line_ + 1 : line_;
+	Char newLineChar = newLineChar_;
+	const std::string& text = text_.str_;
+	for (Uint i = textPos_; i < text.size(); i++) {
+		char ch = text[i];
+		if ((ch == '\r') || (ch == '\n')) {
+			if (((newLineChar == '\r') && (ch == '\n')) || ((newLineChar == '\n') && (ch == '\r'))) {
+				newLineChar = '\0';
+			}
+			else {
+				newLineChar = ch;
+				line++;
+			}
+		}
+		else {
+			newLineChar = '\0';
+		}
+	}
+	return line;
 }
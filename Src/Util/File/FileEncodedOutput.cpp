@@ -1,3 +1,4 @@
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
 #include "Util/CharOutputConverter.hpp"
@@ -6,27 +7,38 @@
 #include "Util/File/FileSystemPlatform.hpp"
 #include "Util/File/FileSystemVirtual.hpp"
 
-FileEncodedOutput::FileEncodedOutput(const CharEncoding& charEncoding, const FilePath& absFilePath) :
+FileEncodedOutput::FileEncodedOutput(const CharEncoding& charEncoding, const FilePath& absFilePath, Uint bufferSize) :
 	charEncoding_(charEncoding),
 	absFilePath_(absFilePath),
 	out_(),
 	converter_(),
-	encodingErrorReported_(false)
+	encodingErrorReported_(false),
+	buf_(),
+	bufSize_(bufferSize),
+	used_(0),
+	encoded_()
 {
+	ASSERT(bufSize_ >= MIN_BUFFER_SIZE);
+
 	out_ = absFilePath.isVirtual() ? FileSystemVirtual::instance()->openForOutput(absFilePath)
 								   : FileSystemPlatform::instance()->openForOutput(absFilePath);
 	if (out_->failed()) {
 		FileSystemErrorHandler::get()->cannotOpenForWrite(absFilePath_);
-		// No need to set converter_ - writes will not happen once
+		// No need to set converter_ or buf_ - writes will not happen once
 		// out_ has failed.
 	}
 	else {
 		converter_ = CharOutputConverter::create(charEncoding_);
+		buf_.reset(new char[bufSize_]);
 	}
 }
 
-FileEncodedOutputPtr FileEncodedOutput::create(const CharEncoding& charEncoding, const FilePath& absFilePath) {
-	return std::make_shared<FileEncodedOutput>(charEncoding, absFilePath);
+FileEncodedOutputPtr FileEncodedOutput::create(
+	const CharEncoding& charEncoding, 
+	const FilePath& absFilePath, 
+	Uint bufferSize) 
+{
+	return std::make_shared<FileEncodedOutput>(charEncoding, absFilePath, bufferSize);
 }
 
 FileEncodedOutput::~FileEncodedOutput() {
@@ -42,36 +54,66 @@ void FileEncodedOutput::write(Char src) {
 		return;
 	}
 
+	// There is room for a carriage return and any character
+	if (bufSize_ - used_ < MIN_BUFFER_SIZE) {
+		writeBuffer();
+		if (out_->failed()) {
+			return;
+		}
+	}
+
 #if BUILD(WINDOWS)
 	if (src == '\n') {
 		// Windows uses a \r\n newline combination
-		write(Char('\r'));
+		used_ += converter_->convertChar(Char('\r'), buf_.get() + used_);
 	}
 #endif
 
-	char buf[CharOutputConverter::MAX_OUTPUT_CHAR_BYTES];
-	Uint len = converter_->convertChar(src, buf);
-
+	Uint len = converter_->convertChar(src, buf_.get() + used_);
 	if (len == 0) {
 		encodingErrorReported_ = true;
 		FileSystemErrorHandler::get()->cannotEncodeForOutput(src);
 	}
 	else {
 		ASSERT(len <= CharOutputConverter::MAX_OUTPUT_CHAR_BYTES);
-		out_->write(buf, len);
-		if (out_->failed()) {
-			FileSystemErrorHandler::get()->writeError(absFilePath_);
-		}
+		used_ += len;
 	}
 }
 
 void FileEncodedOutput::write(const String& src) {
-	for (StringIter pos = src.begin(); !pos.atEnd(); ++pos) {
-		write(*pos);
+	streamString(src);
+}
+
+void FileEncodedOutput::streamUtf8(const char* s, Uint len) {
+	// Encode each line in one piece and then the newline for the platform
+	while ((len > 0) && !out_->failed()) {
+		const char* newline = (const char*)memchr(s, '\n', len);
+		Uint lineLen = (newline != nullptr) ? (Uint)(newline - s) : len;
+		bufferUtf8(s, lineLen);
+		if (newline != nullptr) {
+#if BUILD(WINDOWS)
+			// Windows uses a \r\n newline combination
+			bufferUtf8("\r\n", 2);
+#else
+			bufferUtf8("\n", 1);
+#endif
+			lineLen++;
+		}
+		s += lineLen;
+		len -= lineLen;
+	}
+}
+
+void FileEncodedOutput::flush() {
+	if (!out_->failed()) {
+		writeBuffer();
 	}
 }
 
 void FileEncodedOutput::close() {
+	if (!out_->failed()) {
+		writeBuffer();
+	}
 	if (!out_->failed()) {
 		out_->close();
 		if (out_->failed()) {
@@ -83,3 +125,64 @@ void FileEncodedOutput::close() {
 bool FileEncodedOutput::hasReportedErrors() const {
 	return encodingErrorReported_ || out_->failed();
 }
+
+void FileEncodedOutput::bufferBytes(const char* src, Uint size) {
+	if (size > bufSize_ - used_) {
+		writeBuffer();
+		if (size >= bufSize_) {
+			// Too big to be worth copying
+			if (!out_->failed()) {
+				out_->write(src, size);
+				if (out_->failed()) {
+					FileSystemErrorHandler::get()->writeError(absFilePath_);
+				}
+			}
+			return;
+		}
+	}
+	memcpy(buf_.get() + used_, src, size);
+	used_ += size;
+}
+
+void FileEncodedOutput::bufferUtf8(const char* src, Uint len) {
+	if (charEncoding_ == CharEncoding::UTF8) {
+		// Valid UTF8 needs no conversion
+		bufferBytes(src, len);
+		return;
+	}
+
+	encoded_.clear();
+	if (converter_->convertAppendUtf8(src, len, encoded_)) {
+		bufferBytes(encoded_.data(), (Uint)encoded_.size());
+		return;
+	}
+
+	// There has been an encoding error. Encode one character at a time so
+	// that each character which cannot be encoded is reported.
+	char buf[CharOutputConverter::MAX_OUTPUT_CHAR_BYTES];
+	Uint pos = 0;
+	while (pos < len) {
+		Uint charLen = 0;
+		Char ch = Char::fromUtf8(src + pos, charLen);
+		ASSERT(!ch.isEof() && (charLen <= len - pos));
+		pos += charLen;
+		Uint dstLen = converter_->convertChar(ch, buf);
+		if (dstLen == 0) {
+			encodingErrorReported_ = true;
+			FileSystemErrorHandler::get()->cannotEncodeForOutput(ch);
+		}
+		else {
+			bufferBytes(buf, dstLen);
+		}
+	}
+}
+
+void FileEncodedOutput::writeBuffer() {
+	if ((used_ > 0) && !out_->failed()) {
+		out_->write(buf_.get(), used_);
+		if (out_->failed()) {
+			FileSystemErrorHandler::get()->writeError(absFilePath_);
+		}
+	}
+	used_ = 0;
+}
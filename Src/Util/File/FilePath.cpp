@@ -30,6 +30,11 @@ bool FilePath::exists() const {
 					   : FileSystemPlatform::instance()->fileExists(*this);
 }
 
+bool FilePath::getStatus(Uint64& size, Int64& modifiedTime) const {
+	return isVirtual() ? FileSystemVirtual::instance()->fileStatus(*this, size, modifiedTime)
+					   : FileSystemPlatform::instance()->fileStatus(*this, size, modifiedTime);
+}
+
 DirPath FilePath::getParentDir() const {
 	return FileSystemPlatform::instance()->parentDir(absFilePath_);
 }
@@ -39,13 +44,8 @@ String FilePath::getLeafName() const {
 }
 
 bool FilePath::isVirtual() const {
-	if (FileSystemVirtual::instance()->isEnabled()) {
-		String leaf = getLeafName();
-		if (!leaf.empty() && (*leaf.begin() == Char('$'))) {
-			return true;
-		}
-	}
-	return false;
+	return FileSystemVirtual::instance()->isEnabled() &&
+		   FileSystemPlatform::instance()->leafBeginsWith(absFilePath_, Char('$'));
 }
 
 bool FilePath::operator==(const FilePath& other) const {
@@ -17,6 +17,24 @@ public:
 	// Returns the number of bytes read (possibly 0).
 	virtual Uint read(char* dst, Uint size) = 0;
 
+	// Zero copy alternative to read() for inputs which hold the whole file
+	// in memory (e.g. a memory mapped file). Sets data to point to up to "size"
+	// unread bytes, marks them as read and sets size to the number of bytes
+	// (0 at the end of file). The bytes remain valid for the lifetime of this
+	// object. Returns false, reading nothing, if not supported.
+	virtual bool view(const char*& data, Uint& size) { return false; }
+
+	// Move the read position to "pos" bytes from the start of the file.
+	// Returns false, leaving the position unchanged, if not supported or if
+	// pos is beyond the end of the file.
+	virtual bool seek(Uint pos) { return false; }
+
+	// Positioned read. Read up to "size" bytes starting at position "pos"
+	// into the supplied buffer without changing the read position and set
+	// size to the number of bytes read (0 at or beyond the end of file).
+	// Returns false, reading nothing, if not supported.
+	virtual bool readAt(char* dst, Uint pos, Uint& size) { return false; }
+
 	// Return true if the raw input has failed for some reason
 	// (cannot open file, read error).
 	virtual bool failed() = 0;
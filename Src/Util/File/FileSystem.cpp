@@ -16,6 +16,18 @@ namespace FileSystem {
 		FileSystemVirtual::instance()->setEnable(false);
 	}
 
+	void setVirtualNamespace(Uint ns) {
+		FileSystemVirtual::instance()->setThreadNamespace(ns);
+	}
+
+	Uint getVirtualNamespace() {
+		return FileSystemVirtual::instance()->getThreadNamespace();
+	}
+
+	void setMemoryMapping(bool enable) {
+		FileSystemPlatform::instance()->setMemoryMapping(enable);
+	}
+
 	const String& getPathSeparator() {
 #if BUILD(WINDOWS)
 		static const String ret = "\\";
@@ -1,3 +1,4 @@
+#include <mutex>
 #include "Util/Char.hpp"
 #include "Util/File.hpp"
 
@@ -26,11 +27,20 @@ public:
 // FileSystemErrorHandler
 ///////////////////////////////////////////////////////////////////////////////
 
+// Guards the error handler singleton since files may be used by several threads.
+static std::mutex& instanceMutex() {
+	static std::mutex ret;
+	return ret;
+}
+
 void FileSystemErrorHandler::set(FileSystemErrorHandlerPtr errorHandler) {
-	instance() = errorHandler ? errorHandler : DefaultFileSystemErrorHandler::instance();
+	FileSystemErrorHandlerPtr handler = errorHandler ? errorHandler : DefaultFileSystemErrorHandler::instance();
+	std::lock_guard<std::mutex> lock(instanceMutex());
+	instance() = handler;
 }
 
 FileSystemErrorHandlerPtr FileSystemErrorHandler::get() {
+	std::lock_guard<std::mutex> lock(instanceMutex());
 	return instance();
 }
 
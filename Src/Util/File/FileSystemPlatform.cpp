@@ -1,10 +1,21 @@
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include "Util/Assert.hpp"
 #include "Util/File.hpp"
 #include "Util/File/FileRawInput.hpp"
 #include "Util/File/FileRawOutput.hpp"
 #include "Util/File/FileSystemPlatform.hpp"
+#include "Util/Windows.hpp"
+
+#if BUILD(LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if BUILD(WINDOWS)
 namespace fs = std::experimental::filesystem::v1;
@@ -19,14 +30,13 @@ namespace fs = std::experimental::filesystem::v1;
 // Convert a std::filesystem file path to a String handling
 // non-ASCII characters correctly.
 static String fsToString(const fs::path& fsPath) {
-	std::string s = fsPath.u8string();
-	return String(s);
+	return String::fromPlatform(fsPath.native());
 }
 
 // Convert a String to a std::filesystem file path handling
 // non-ASCII characters correctly.
 static fs::path stringToFs(const String& strPath) {
-	return fs::u8path(strPath.toUtf8());
+	return fs::path(strPath.toPlatform());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -77,15 +87,178 @@ public:
 		}
 		return readSize;
 	}
+	bool seek(Uint pos) {
+		if (fail_ || (pos > getSize())) {
+			return false;
+		}
+		try {
+			if (fin_.rdbuf()->pubseekpos(pos, std::ios::in) != std::streampos(pos)) {
+				fail_ = true;
+				return false;
+			}
+			atEof_ = false;
+			return true;
+		}
+		catch (...) {
+			fail_ = true;
+			return false;
+		}
+	}
+	bool readAt(char* dst, Uint pos, Uint& size) {
+		if (fail_) {
+			return false;
+		}
+		try {
+			std::filebuf* rdbuf = fin_.rdbuf();
+			std::streampos oldPos = rdbuf->pubseekoff(0, std::ios::cur, std::ios::in);
+			if ((oldPos == std::streampos(-1)) || (rdbuf->pubseekpos(pos, std::ios::in) != std::streampos(pos))) {
+				size = 0;
+			}
+			else {
+				size = (Uint)rdbuf->sgetn(dst, size);
+			}
+			rdbuf->pubseekpos(oldPos, std::ios::in);
+			return true;
+		}
+		catch (...) {
+			fail_ = true;
+			return false;
+		}
+	}
 	bool failed() {
 		return fail_;
 	}
+private:
+	// Get the file size without changing the read position
+	Uint getSize() {
+		std::filebuf* rdbuf = fin_.rdbuf();
+		std::streampos oldPos = rdbuf->pubseekoff(0, std::ios::cur, std::ios::in);
+		std::streampos endPos = rdbuf->pubseekoff(0, std::ios::end, std::ios::in);
+		rdbuf->pubseekpos(oldPos, std::ios::in);
+		return (Uint)std::min((std::streamoff)endPos, (std::streamoff)std::numeric_limits<Uint>::max());
+	}
+
 private:
 	std::ifstream fin_;
 	bool fail_;
 	bool atEof_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// MappedFileRawInput
+///////////////////////////////////////////////////////////////////////////////
+
+// A raw input for a memory mapped file. This avoids the copy from the kernel
+// into the stream buffer and supports view() for zero copy access. The file
+// must be non-empty.
+class MappedFileRawInput : public FileRawInput {
+public:
+	MappedFileRawInput(const FilePath& path) :
+		FileRawInput(),
+		data_(nullptr),
+		size_(0),
+		pos_(0)
+	{
+#if BUILD(WINDOWS)
+		HANDLE file = CreateFileW(path.str().toPlatform().c_str(), GENERIC_READ, FILE_SHARE_READ,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(file, &fileSize) && 
+			(fileSize.QuadPart > 0) && 
+			((Uint64)fileSize.QuadPart <= std::numeric_limits<Uint>::max()))
+		{
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr) {
+				data_ = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (data_ != nullptr) {
+					size_ = (Uint)fileSize.QuadPart;
+				}
+				// The view keeps the mapping alive
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#elif BUILD(LINUX)
+		int fd = ::open(path.str().toPlatform().c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+		struct stat st;
+		if ((fstat(fd, &st) == 0) && 
+			S_ISREG(st.st_mode) && 
+			(st.st_size > 0) && 
+			((Uint64)st.st_size <= std::numeric_limits<Uint>::max()))
+		{
+			void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+				data_ = (const char*)data;
+				size_ = (Uint)st.st_size;
+			}
+		}
+		// The mapping stays valid after the file is closed
+		::close(fd);
+#else
+#error "Illegal OS"
+#endif
+	}
+	~MappedFileRawInput() {
+		if (data_ != nullptr) {
+#if BUILD(WINDOWS)
+			UnmapViewOfFile(data_);
+#elif BUILD(LINUX)
+			munmap((void*)data_, size_);
+#else
+#error "Illegal OS"
+#endif
+		}
+	}
+	Uint read(char* dst, Uint size) {
+		const char* src;
+		if (!view(src, size)) {
+			return 0;
+		}
+		memcpy(dst, src, size);
+		return size;
+	}
+	bool view(const char*& data, Uint& size) {
+		if (data_ == nullptr) {
+			return false;
+		}
+		data = data_ + pos_;
+		size = std::min(size, size_ - pos_);
+		pos_ += size;
+		return true;
+	}
+	bool seek(Uint pos) {
+		if ((data_ == nullptr) || (pos > size_)) {
+			return false;
+		}
+		pos_ = pos;
+		return true;
+	}
+	bool readAt(char* dst, Uint pos, Uint& size) {
+		if (data_ == nullptr) {
+			return false;
+		}
+		size = (pos < size_) ? std::min(size, size_ - pos) : 0;
+		if (size > 0) {
+			memcpy(dst, data_ + pos, size);
+		}
+		return true;
+	}
+	bool failed() {
+		return data_ == nullptr;
+	}
+private:
+	const char* data_;	// The mapped file or null if not mapped
+	Uint size_;			// The file size
+	Uint pos_;			// The read position
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // PlatformFileRawOutput
 ///////////////////////////////////////////////////////////////////////////////
@@ -151,7 +324,8 @@ private:
 
 FileSystemPlatform::FileSystemPlatform() :
 	workingDirIsInitialised_(false),
-	workingDir_()
+	workingDir_(),
+	memoryMapping_(true)
 {
 }
 
@@ -245,6 +419,27 @@ bool FileSystemPlatform::fileExists(const FilePath& path) {
 	}
 }
 
+bool FileSystemPlatform::fileStatus(const FilePath& path, Uint64& size, Int64& modifiedTime) {
+	if (!path.isValid()) {
+		return false;
+	}
+	else {
+		fs::path bfp = stringToFs(path.str());
+		std::error_code ec;
+		std::uintmax_t fileSize = fs::file_size(bfp, ec);
+		if (ec) {
+			return false;
+		}
+		fs::file_time_type fileTime = fs::last_write_time(bfp, ec);
+		if (ec) {
+			return false;
+		}
+		size = (Uint64)fileSize;
+		modifiedTime = (Int64)fileTime.time_since_epoch().count();
+		return true;
+	}
+}
+
 DirPath FileSystemPlatform::parentDir(const String& path) {
 	if (path.empty()) {
 		return DirPath();
@@ -277,10 +472,32 @@ String FileSystemPlatform::leafName(const String& path) {
 	}
 }
 
+bool FileSystemPlatform::leafBeginsWith(const String& path, Char ch) {
+	StringIter pos = path.findLast(Char((char)fs::path::preferred_separator));
+	if (pos.atEnd()) {
+		return false;
+	}
+	pos++;
+	return *pos == ch;
+}
+
 FileRawInputPtr FileSystemPlatform::openForInput(const FilePath& path) {
+	// Map large files. Fall back to a stream if the file cannot be mapped.
+	std::error_code ec;
+	std::uintmax_t size = fs::file_size(stringToFs(path.str()), ec);
+	if (memoryMapping_ && !ec && (size >= MAP_THRESHOLD) && (size <= std::numeric_limits<Uint>::max())) {
+		FileRawInputPtr mapped = std::make_shared<MappedFileRawInput>(path);
+		if (!mapped->failed()) {
+			return mapped;
+		}
+	}
 	return std::make_shared<PlatformFileRawInput>(path);
 }
 
+void FileSystemPlatform::setMemoryMapping(bool enable) {
+	memoryMapping_ = enable;
+}
+
 FileRawOutputPtr FileSystemPlatform::openForOutput(const FilePath& path) {
 	return std::make_shared<PlatformFileRawOutput>(path);
 }
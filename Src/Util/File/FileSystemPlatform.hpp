@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <set>
 #include "Util/Def.hpp"
@@ -51,6 +52,10 @@ public:
 	// Returns true if the given file path is valid, exists and is a file.
 	bool fileExists(const FilePath& path);
 
+	// Get the size and last write time of a file. Returns false if the file
+	// path is invalid or the file does not exist.
+	bool fileStatus(const FilePath& path, Uint64& size, Int64& modifiedTime);
+
 	// Get the parent directory of the given path or DirPath()
 	// if there is an error or there is no such directory.
 	DirPath parentDir(const String& path);
@@ -60,8 +65,19 @@ public:
 	// an error. Does not work with Unicode yet - see FileTest.cpp.
 	String leafName(const String& path);
 
-	// Opens a platform file for raw binary input.
+	// Returns true if the final leaf of a path in standard form (as made by
+	// makePath()) begins with the given character. This only searches for
+	// the last separator so it is much faster than leafName().
+	bool leafBeginsWith(const String& path, Char ch);
+
+	// Opens a platform file for raw binary input. Regular files of at least
+	// MAP_THRESHOLD bytes are memory mapped so that the input supports
+	// FileRawInput::view(), unless memory mapping is disabled.
 	FileRawInputPtr openForInput(const FilePath& path);
+	static const Uint MAP_THRESHOLD = 64 * 1024;
+
+	// Enable or disable memory mapping in openForInput().
+	void setMemoryMapping(bool enable);
 
 	// Opens a platform file for raw binary output.
 	FileRawOutputPtr openForOutput(const FilePath& path);
@@ -74,5 +90,6 @@ public:
 private:
 	bool workingDirIsInitialised_;
 	DirPath workingDir_;
+	std::atomic<bool> memoryMapping_;	// True if openForInput() maps large files
 };
 
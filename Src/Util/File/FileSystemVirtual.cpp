@@ -1,5 +1,6 @@
 #include <algorithm>
-#include <deque>
+#include <cstring>
+#include <limits>
 #include "Util/File.hpp"
 #include "Util/File/FileRawInput.hpp"
 #include "Util/File/FileRawOutput.hpp"
@@ -10,82 +11,136 @@
 // FileVirtualContent
 ///////////////////////////////////////////////////////////////////////////////
 
-// The contents of a virtual file (stored in binary)
+// An immutable snapshot of the contents of a virtual file.
+struct FileVirtualSnapshot {
+	std::shared_ptr<const char> block;	// The bytes of the file or null if empty
+	Uint size;							// The file size
+	Int64 modifiedTime;					// The modification time
+};
+
+// The contents of a virtual file (stored in binary). The bytes are held in
+// one contiguous block so that readers can view them without copying. The
+// block grows geometrically and when it grows the bytes are copied to a new
+// block. The bytes in a block are never changed once written so a snapshot
+// of the block and size stays valid while the file is written to.
 class FileVirtualContent {
 public:
 	// Constructor for an empty file
 	FileVirtualContent() :
-		data_()
+		mutex_(),
+		block_(),
+		capacity_(0),
+		size_(0),
+		modifiedTime_(++writeCount_)
 	{
 	}
-	
-	// Get the file size in bytes
-	Uint getSize() const { 
-		return (Uint)data_.size(); 
-	}
 
-	// Read up to "size" bytes into the supplied buffer
-	// starting at position pos.
-	// Stops reading if the end of file is reached.
-	// Returns the number of bytes read (possibly 0).
-	Uint read(char* dst, Uint pos, Uint size) {
-		if (pos >= getSize()) {
-			return 0u;
-		}
-		else {
-			Uint actualSize = std::min(size, getSize() - pos);
-			char* p = dst;
-			std::deque<char>::const_iterator it = data_.begin() + pos;
-			for (Uint i = 0; i < actualSize; ++i) {
-				*p++ = *it++;
-			}
-			return actualSize;
-		}
+	// Get a snapshot of the current contents.
+	FileVirtualSnapshot getSnapshot() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		FileVirtualSnapshot ret = { block_, size_, modifiedTime_ };
+		return ret;
 	}
 
 	// Write "size" bytes from "src" to the end of the file
 	void write(const char* src, Uint size) { 
-		const char* p = src;
-		for (Uint i = 0; i < size; ++i) {
-			data_.push_back(*p++);
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (size > capacity_ - size_) {
+			ASSERT(size <= std::numeric_limits<Uint>::max() - size_);
+			Uint64 capacity = std::max((Uint64)size_ + size, std::max((Uint64)capacity_ * 2u, (Uint64)MIN_CAPACITY));
+			capacity_ = (Uint)std::min(capacity, (Uint64)std::numeric_limits<Uint>::max());
+			std::shared_ptr<char> block(new char[capacity_], std::default_delete<char[]>());
+			if (size_ > 0) {
+				memcpy(block.get(), block_.get(), size_);
+			}
+			block_ = block;
 		}
+		memcpy(block_.get() + size_, src, size);
+		size_ += size;
+		modifiedTime_ = ++writeCount_;
 	}
 
 private:
-	std::deque<char> data_;
+	// The capacity of the first block
+	static const Uint MIN_CAPACITY = 4096;
+
+	mutable std::mutex mutex_;		// Guards the members below
+	std::shared_ptr<char> block_;	// The bytes of the file or null if none have been written
+	Uint capacity_;					// The size of block_
+	Uint size_;						// The file size
+	Int64 modifiedTime_;
+	static std::atomic<Int64> writeCount_;
 };
 
+std::atomic<Int64> FileVirtualContent::writeCount_(0);
+
 ///////////////////////////////////////////////////////////////////////////////
 // VirtualFileRawInput
 ///////////////////////////////////////////////////////////////////////////////
 
 // The only failure is when no content is supplied at the outset (presumably
-// because the file could not be found).
+// because the file could not be found). The input reads a snapshot of the
+// content taken when it was opened and supports view() since the whole
+// snapshot is in memory.
 class VirtualFileRawInput : public FileRawInput {
 public:
 	VirtualFileRawInput(FileVirtualContentPtr content) :
 		FileRawInput(),
-		content_(content),
+		exists_(content != nullptr),
+		snapshot_(),
 		pos_(0)
 	{
+		if (content) {
+			snapshot_ = content->getSnapshot();
+		}
+		else {
+			snapshot_.size = 0;
+			snapshot_.modifiedTime = 0;
+		}
 	}
 	~VirtualFileRawInput() {
 	}
 	Uint read(char* dst, Uint size) {
-		if (!content_ || (size == 0)) {
-			return 0;
+		Uint readSize = 0;
+		if (readAt(dst, pos_, size)) {
+			readSize = size;
+			pos_ += readSize;
 		}
-
-		Uint readSize = content_->read(dst, pos_, size);
-		pos_ += readSize;
 		return readSize;
 	}
+	bool view(const char*& data, Uint& size) {
+		if (!exists_) {
+			return false;
+		}
+		size = std::min(size, snapshot_.size - pos_);
+		data = (size > 0) ? snapshot_.block.get() + pos_ : "";
+		pos_ += size;
+		return true;
+	}
+	bool seek(Uint pos) {
+		if (!exists_ || (pos > snapshot_.size)) {
+			return false;
+		}
+		pos_ = pos;
+		return true;
+	}
+	bool readAt(char* dst, Uint pos, Uint& size) {
+		if (!exists_) {
+			return false;
+		}
+		size = (pos < snapshot_.size) ? std::min(size, snapshot_.size - pos) : 0;
+		if (size > 0) {
+			memcpy(dst, snapshot_.block.get() + pos, size);
+		}
+		return true;
+	}
 	bool failed() {
-		return content_ == 0;
+		return !exists_;
 	}
 private:
-	FileVirtualContentPtr content_;
-	Uint pos_;
+	bool exists_;					// False if there is no content
+	FileVirtualSnapshot snapshot_;	// The content when opened
+	Uint pos_;						// The read position
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -123,9 +178,13 @@ private:
 // FileSystemVirtual
 ///////////////////////////////////////////////////////////////////////////////
 
+thread_local Uint FileSystemVirtual::threadNamespace_ = 0;
+thread_local FileSystemVirtual::Namespace* FileSystemVirtual::threadNamespacePtr_ = nullptr;
+
 FileSystemVirtual::FileSystemVirtual() :
-	isEnabled_(false),
-	map_()
+	pathTable_(),
+	namespacesMutex_(),
+	namespaces_()
 {
 }
 
@@ -134,48 +193,165 @@ FileSystemVirtualPtr FileSystemVirtual::instance() {
 	return ret;
 }
 
+void FileSystemVirtual::setThreadNamespace(Uint ns) {
+	threadNamespace_ = ns;
+	threadNamespacePtr_ = nullptr;
+}
+
+Uint FileSystemVirtual::getThreadNamespace() {
+	return threadNamespace_;
+}
+
 void FileSystemVirtual::setEnable(bool status) {
-	isEnabled_ = status;
-	map_.clear();
+	Namespace& ns = getNamespace();
+	ns.isEnabled = status;
+	for (Shard& shard : ns.shards) {
+		std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+		if (status) {
+			shard.slots.clear();
+		}
+		else {
+			// Release the memory of the tables when stopping since clear()
+			// keeps their capacity
+			std::vector<Shard::Slot>().swap(shard.slots);
+		}
+		shard.count = 0;
+	}
 }
 
 bool FileSystemVirtual::isEnabled() {
-	return isEnabled_;
+	return getNamespace().isEnabled;
 }
 
 bool FileSystemVirtual::fileExists(const FilePath& path) {
-	if (!path.isValid()) {
+	return find(path) != nullptr;
+}
+
+bool FileSystemVirtual::fileStatus(const FilePath& path, Uint64& size, Int64& modifiedTime) {
+	FileVirtualContentPtr content = find(path);
+	if (!content) {
 		return false;
 	}
-	else {
-		MapType::const_iterator it = map_.find(path.str());
-		return it != map_.end();
-	}
+	FileVirtualSnapshot snapshot = content->getSnapshot();
+	size = snapshot.size;
+	modifiedTime = snapshot.modifiedTime;
+	return true;
 }
 
 FileRawInputPtr FileSystemVirtual::openForInput(const FilePath& path) {
-	FileVirtualContentPtr content;
-
-	MapType::const_iterator it = map_.find(path.str());
-	if (it != map_.end()) {
-		content = it->second;
-	}
-	return std::make_shared<VirtualFileRawInput>(content);
+	return std::make_shared<VirtualFileRawInput>(find(path));
 }
 
 FileRawOutputPtr FileSystemVirtual::openForOutput(const FilePath& path) {
-	// Create new content
+	// Create new content which overwrites any existing content
 	FileVirtualContentPtr content = std::make_shared<FileVirtualContent>();
+	Uint id = internPath(path.absFilePath_, true);
+	Shard& shard = getShard(getNamespace(), id);
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+		if ((shard.count + 1) * 2 > shard.slots.size()) {
+			// Keep the table at most half full
+			std::vector<Shard::Slot> slots(std::max(shard.slots.size() * 2, (size_t)MIN_SLOTS));
+			std::swap(slots, shard.slots);
+			for (Shard::Slot& slot : slots) {
+				if (slot.id != NO_ID) {
+					findContentSlot(shard, slot.id) = std::move(slot);
+				}
+			}
+		}
+		Shard::Slot& slot = findContentSlot(shard, id);
+		if (slot.id == NO_ID) {
+			slot.id = id;
+			shard.count++;
+		}
+		slot.content = content;
+	}
+	return std::make_shared<VirtualFileRawOutput>(content);
+}
 
-	MapType::iterator it = map_.find(path.str());
-	if (it != map_.end()) {
-		// Overwrite existing content
-		it->second = content;
+FileSystemVirtual::Namespace& FileSystemVirtual::getNamespace() {
+	if (threadNamespacePtr_ == nullptr) {
+		std::lock_guard<std::mutex> lock(namespacesMutex_);
+		std::unique_ptr<Namespace>& ns = namespaces_[threadNamespace_];
+		if (!ns) {
+			ns.reset(new Namespace());
+		}
+		threadNamespacePtr_ = ns.get();
 	}
-	else {
-		// Create a new entry
-		map_.insert(std::make_pair(path.str(), content));
+	return *threadNamespacePtr_;
+}
+
+Uint FileSystemVirtual::internPath(const String& path, bool add) {
+	size_t hash = StringHash()(path);
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(pathTable_.mutex);
+		Uint id = pathTable_.slots.empty() ? NO_ID : findPathSlot(path, hash).id;
+		if ((id != NO_ID) || !add) {
+			return id;
+		}
 	}
 
-	return std::make_shared<VirtualFileRawOutput>(content);
+	// Add the path checking again since another thread may have added it
+	std::unique_lock<std::shared_timed_mutex> lock(pathTable_.mutex);
+	if ((pathTable_.paths.size() + 1) * 2 > pathTable_.slots.size()) {
+		// Keep the index at most half full
+		PathTable::Slot empty = { 0, NO_ID };
+		std::vector<PathTable::Slot> slots(std::max(pathTable_.slots.size() * 2, (size_t)MIN_SLOTS), empty);
+		std::swap(slots, pathTable_.slots);
+		size_t mask = pathTable_.slots.size() - 1;
+		for (const PathTable::Slot& slot : slots) {
+			if (slot.id != NO_ID) {
+				size_t i = slot.hash & mask;
+				while (pathTable_.slots[i].id != NO_ID) {
+					i = (i + 1) & mask;
+				}
+				pathTable_.slots[i] = slot;
+			}
+		}
+	}
+	PathTable::Slot& slot = findPathSlot(path, hash);
+	if (slot.id == NO_ID) {
+		slot.hash = hash;
+		slot.id = (Uint)pathTable_.paths.size();
+		pathTable_.paths.push_back(path);
+	}
+	return slot.id;
+}
+
+FileSystemVirtual::PathTable::Slot& FileSystemVirtual::findPathSlot(const String& path, size_t hash) {
+	size_t mask = pathTable_.slots.size() - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		PathTable::Slot& slot = pathTable_.slots[i];
+		if ((slot.id == NO_ID) || ((slot.hash == hash) && (pathTable_.paths[slot.id] == path))) {
+			return slot;
+		}
+	}
+}
+
+FileSystemVirtual::Shard& FileSystemVirtual::getShard(Namespace& ns, Uint id) {
+	return ns.shards[id % SHARD_COUNT];
+}
+
+FileSystemVirtual::Shard::Slot& FileSystemVirtual::findContentSlot(Shard& shard, Uint id) {
+	// Ids are allocated in sequence so a multiplicative hash spreads them
+	size_t mask = shard.slots.size() - 1;
+	for (size_t i = ((id / SHARD_COUNT) * 2654435761u) & mask; ; i = (i + 1) & mask) {
+		Shard::Slot& slot = shard.slots[i];
+		if ((slot.id == NO_ID) || (slot.id == id)) {
+			return slot;
+		}
+	}
+}
+
+FileVirtualContentPtr FileSystemVirtual::find(const FilePath& path) {
+	if (!path.isValid()) {
+		return FileVirtualContentPtr();
+	}
+	Uint id = internPath(path.absFilePath_, false);
+	if (id == NO_ID) {
+		return FileVirtualContentPtr();
+	}
+	Shard& shard = getShard(getNamespace(), id);
+	std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+	return shard.slots.empty() ? FileVirtualContentPtr() : findContentSlot(shard, id).content;
 }
@@ -1,6 +1,10 @@
 #pragma once
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 #include "Util/Def.hpp"
 #include "Util/File.hpp"
 #include "Util/String.hpp"
@@ -10,6 +14,16 @@ DPTR(FileVirtualContent)
 
 // The virtual file system maps the name of a virtual file to its
 // content. Only absolute file names are allowed (no . or ..).
+//
+// It is thread safe. The files are held in namespaces which are independent
+// virtual file systems and each thread uses the namespace it has selected
+// (initially namespace 0). Paths are interned: each distinct path is stored
+// once with its hash and given an id, and the namespaces index their files
+// by id. Within a namespace the ids are split between shards, each with its
+// own reader-writer lock, so threads only contend when they use paths in
+// the same shard. An input opened on a file
+// reads a snapshot of its content at the time it was opened which is not
+// affected by later writes.
 class FileSystemVirtual {
 private:
 	ALLOW_MAKE_SHARED(FileSystemVirtual);
@@ -20,18 +34,30 @@ public:
 	// Singleton instance
 	static FileSystemVirtualPtr instance();
 
-	// Enable or disable the virtual file system.
-	// Either call has the effect of clearing all existing content
-	// although the content of existing open files will persist
-	// until they are closed.
+	// Select the namespace used by the calling thread.
+	void setThreadNamespace(Uint ns);
+
+	// Get the namespace used by the calling thread.
+	Uint getThreadNamespace();
+
+	// Enable or disable the virtual file system for the namespace of the
+	// calling thread. Either call has the effect of clearing all existing
+	// content in the namespace although the content of existing open files
+	// will persist until they are closed.
 	void setEnable(bool status);
 
-	// Returns true if the virtual file system is enabled.
+	// Returns true if the virtual file system is enabled for the namespace
+	// of the calling thread.
 	bool isEnabled();
 
 	// Returns true if the given file path is valid, exists and is a virtual file.
 	bool fileExists(const FilePath& path);
 
+	// Get the size and modification time of a virtual file. Virtual files
+	// have no clock so the time is a count which increases every time any
+	// virtual file is written. Returns false if the file does not exist.
+	bool fileStatus(const FilePath& path, Uint64& size, Int64& modifiedTime);
+
 	// Opens a virtual file for raw binary input.
 	FileRawInputPtr openForInput(const FilePath& path);
 
@@ -39,11 +65,84 @@ public:
 	FileRawOutputPtr openForOutput(const FilePath& path);
 
 private:
-	// True if the virtual file system is enabled.
-	bool isEnabled_;
+	// The number of shards in a namespace
+	static const Uint SHARD_COUNT = 16;
 
-	// Map from file path to its virtual data.
-	typedef std::map<String, FileVirtualContentPtr> MapType;
-	MapType map_;
-};
+	// The id of a path which has not been interned
+	static const Uint NO_ID = 0xffffffffu;
+
+	// The initial number of slots in a hash table
+	static const Uint MIN_SLOTS = 64;
+
+	// The table of interned paths. Paths are never removed so an id stays
+	// valid for the life of the program. The index is an open addressing
+	// hash table holding the hash of each path so that probing only
+	// compares the strings when the hashes match.
+	struct PathTable {
+		struct Slot {
+			size_t hash;	// The hash of the path
+			Uint id;		// The index in paths or NO_ID if the slot is empty
+		};
+		std::shared_timed_mutex mutex;	// Shared for lookups, exclusive for additions
+		std::vector<Slot> slots;		// The index (a power of 2 in size or empty)
+		std::vector<String> paths;		// The paths by id
+	};
+
+	// A shard of the map from path id to its virtual data. This is an open
+	// addressing hash table keyed by path id. Files are only removed all
+	// at once so no tombstones are needed.
+	struct Shard {
+		struct Slot {
+			Slot() : id(NO_ID), content() { }
+			Uint id;						// The path id or NO_ID if the slot is empty
+			FileVirtualContentPtr content;	// The file content
+		};
+		Shard() : count(0) { }
+		std::shared_timed_mutex mutex;	// Shared for lookups, exclusive for changes
+		std::vector<Slot> slots;		// The table (a power of 2 in size or empty)
+		Uint count;						// The number of slots used
+	};
+
+	// An independent virtual file system.
+	struct Namespace {
+		Namespace() : isEnabled(false) { }
+		std::atomic<bool> isEnabled;	// True if the virtual file system is enabled
+		Shard shards[SHARD_COUNT];		// The files split by path id (id % SHARD_COUNT)
+	};
+
+	// Get the namespace of the calling thread.
+	Namespace& getNamespace();
 
+	// Get the id of an interned path. If the path has not been interned then
+	// it is added if "add" is true and otherwise NO_ID is returned.
+	Uint internPath(const String& path, bool add);
+
+	// Find a path in the path table index which must be locked and have at
+	// least one slot. Returns the slot holding the path or the empty slot
+	// where it belongs.
+	PathTable::Slot& findPathSlot(const String& path, size_t hash);
+
+	// Get the shard which holds a path id.
+	static Shard& getShard(Namespace& ns, Uint id);
+
+	// Find a path id in a shard which must be locked and have at least one
+	// slot. Returns the slot holding the id or the empty slot where it belongs.
+	static Shard::Slot& findContentSlot(Shard& shard, Uint id);
+
+	// Get the content of a file or null if it does not exist.
+	FileVirtualContentPtr find(const FilePath& path);
+
+private:
+	// The interned paths shared by all namespaces
+	PathTable pathTable_;
+
+	// Map from namespace number to namespace. Namespaces are never removed
+	// so that threads can keep a pointer to theirs without locking.
+	std::mutex namespacesMutex_;
+	std::map<Uint, std::unique_ptr<Namespace>> namespaces_;
+
+	// The namespace selected by the calling thread and a pointer to it (null
+	// until first used).
+	static thread_local Uint threadNamespace_;
+	static thread_local Namespace* threadNamespacePtr_;
+};
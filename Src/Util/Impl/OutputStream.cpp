@@ -1,9 +1,61 @@
-#include <iostream>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include "Util/Assert.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/OutputStream.hpp"
 #include "Util/String.hpp"
 
+namespace {
+	// Get the length of a null terminated UTF8 string asserting that it is
+	// valid UTF8.
+	Uint validUtf8Length(const char* s) {
+		Uint len = (Uint)strlen(s);
+		Uint pos = Utf8Scan::validPrefixLength(s, len);
+		while (pos < len) {
+			// The string is null terminated so this cannot read beyond the end
+			Uint charLen = 0;
+			ASSERT(!Char::fromUtf8(s + pos, charLen).isEof());
+			pos += charLen;
+		}
+		return len;
+	}
+
+	// Format an integer in decimal and stream it as one piece of UTF8.
+	template <typename T> void streamInteger(OutputStream& os, T x) {
+		typedef typename std::make_unsigned<T>::type Unsigned;
+		char buf[24];
+		char* end = buf + sizeof(buf);
+		char* p = end;
+		bool negative = (x < 0);
+		Unsigned value = negative ? (Unsigned)(0u - (Unsigned)x) : (Unsigned)x;
+		do {
+			*--p = (char)('0' + value % 10u);
+			value /= 10u;
+		} while (value != 0);
+		if (negative) {
+			*--p = '-';
+		}
+		os.streamUtf8(p, (Uint)(end - p));
+	}
+}
+
+void OutputStream::streamUtf8(const char* s, Uint len) {
+	// Valid UTF8 so decoding a character never reads beyond the end
+	Uint pos = 0;
+	while (pos < len) {
+		Uint charLen = 0;
+		Char ch = Char::fromUtf8(s + pos, charLen);
+		ASSERT(!ch.isEof() && (charLen <= len - pos));
+		streamChar(ch);
+		pos += charLen;
+	}
+}
+
+void OutputStream::streamString(const String& s) {
+	streamUtf8(s.str_.data(), (Uint)s.str_.size());
+}
+
 OutputStream& operator<<(OutputStream& os, bool x) {
 	FAIL;
 }
@@ -14,43 +66,37 @@ OutputStream& operator<<(OutputStream& os, char x) {
 }
 
 OutputStream& operator<<(OutputStream& os, const char* x) {
-	os << String(x);
+	os.streamUtf8(x, validUtf8Length(x));
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, int x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, long x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, long long x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, unsigned int x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, unsigned long x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
 OutputStream& operator<<(OutputStream& os, unsigned long long x) {
-	std::string s = std::to_string(x);
-	os << String(s);
+	streamInteger(os, x);
 	return os;
 }
 
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/Char.hpp"
-#include "Util/CharOutputConverter.hpp"
+#include "Util/Char/Utf16Scan.hpp"
+#include "Util/Char/Utf8Scan.hpp"
 #include "Util/String.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -175,7 +178,7 @@ StringIterPair::StringIterPair(const StringIter& first__, const StringIter& seco
 String::String(const StringIter& from, const StringIter& to) {
 	ASSERT(from.s_ == to.s_);
 	ASSERT(from.pos_ <= to.pos_);
-	str_ = from.s_->str_.substr(from.pos_, to.pos_ - from.pos_);
+	str_.assign(from.s_->str_, from.pos_, to.pos_ - from.pos_);
 }
 
 Char String::back() const {
@@ -189,6 +192,7 @@ Char String::back() const {
 
 String& String::operator+=(Char ch) {
 	ASSERT(ch != Char::eof());
+	index_.reset();
 	if (ch.isAscii()) {
 		str_ += (char)ch.toUtf32();
 	}
@@ -203,6 +207,62 @@ String& String::operator+=(Char ch) {
 	return *this;
 }
 
+Char String::at(Uint pos) const {
+	ASSERT(pos < size());
+	Uint len = 0;
+	return Char::fromUtf8(str_.c_str() + bytePosition(pos), len);
+}
+
+StringIter String::iterAt(Uint pos) const {
+	return StringIter(*this, bytePosition(pos));
+}
+
+const String::Index& String::getIndex() const {
+	const Index* ret = index_.get();
+	if (ret == nullptr) {
+		std::unique_ptr<Index> index(new Index());
+		const char* p = str_.data();
+		Uint len = (Uint)str_.size();
+		if (Utf8Scan::asciiPrefixLength(p, len) == len) {
+			// Character and byte positions are the same
+			index->size = len;
+		}
+		else {
+			// Count the bytes which are not UTF8 continuation bytes
+			Uint count = 0;
+			for (Uint i = 0; i < len; i++) {
+				if (((Uint8)p[i] & 0xc0u) != 0x80u) {
+					if (count % INDEX_INTERVAL == 0) {
+						index->marks.push_back(i);
+					}
+					count++;
+				}
+			}
+			index->size = count;
+		}
+		ret = index_.publish(std::move(index));
+	}
+	return *ret;
+}
+
+Uint String::bytePosition(Uint pos) const {
+	const Index& index = getIndex();
+	ASSERT(pos <= index.size);
+	if (index.marks.empty()) {
+		return pos;
+	}
+	if (pos == index.size) {
+		return (Uint)str_.size();
+	}
+	Uint ret = index.marks[pos / INDEX_INTERVAL];
+	for (Uint skip = pos % INDEX_INTERVAL; skip > 0; skip--) {
+		// Step over one character using the length given by its lead byte
+		Uint8 lead = (Uint8)str_[ret];
+		ret += (lead < 0x80u) ? 1u : (lead < 0xe0u) ? 2u : (lead < 0xf0u) ? 3u : 4u;
+	}
+	return ret;
+}
+
 StringIterPair String::findFirst(const String& str) const {
 	std::string::size_type pos = str_.find(str.str_);
 	if (pos == std::string::npos) {
@@ -259,32 +319,82 @@ StringIter String::findLast(Char ch) const {
 
 #if BUILD(MSV)
 PlatformString String::toPlatform() const {
-	CharOutputConverterPtr cv = CharOutputConverter::create(CharEncoding::UTF16LE);
-	std::string out = cv->convertString(*this);
-	ASSERT(sizeof(wchar_t) == 2);
-	ASSERT(out.size() % 2 == 0);
-	return PlatformString((const wchar_t*)out.c_str(), out.size() / 2);
+	// Converted straight into the result which is sized for the worst case
+	// of one UTF16 word per UTF8 byte.
+	PlatformString ret(str_.size(), L'\0');
+	ret.resize(Utf16Scan::fromUtf8(str_.data(), (Uint)str_.size(), &ret[0]));
+	return ret;
+}
+
+String String::fromPlatform(const PlatformString& s) {
+	// Converted straight into the result which is sized for the worst case
+	// of three UTF8 bytes per UTF16 word.
+	String ret;
+	std::string& out = ret.str_;
+	const char* src = (const char*)s.data();
+	Uint size = (Uint)s.size();
+	out.resize(3 * size);
+	Uint in = 0;
+	Uint outLen = 0;
+	while (in < size) {
+		in += Utf16Scan::toUtf8(src + 2 * in, size - in, size - in, false, &out[0], outLen);
+		if (in < size) {
+			// An unpaired surrogate
+			outLen += Utf8Scan::encode(0xfffdu, &out[outLen]);
+			in++;
+		}
+	}
+	out.resize(outLen);
+	return ret;
 }
 #else
-PlatformString toPlatform() const {
+PlatformString String::toPlatform() const {
 	// The platform string is just UTF8.
 	return str_;
 }
+
+String String::fromPlatform(const PlatformString& s) {
+	return String(s);
+}
 #endif
 
 String String::toUpperCopy() const {
-	String ret;
-	for (StringIter it = begin(); !it.atEnd(); ++it) {
-		ret += it->toUpperCopy();
-	}
-	return ret;
+	return caseCopy(true);
 }
 
 String String::toLowerCopy() const {
+	return caseCopy(false);
+}
+
+String String::caseCopy(bool upperNotLower) const {
+	// Runs of ASCII are converted in bulk and other characters one at a time.
+	// The output is sized for the input and grown if a converted character
+	// is longer than the original.
 	String ret;
-	for (StringIter it = begin(); !it.atEnd(); ++it) {
-		ret += it->toLowerCopy();
+	std::string& out = ret.str_;
+	Uint size = (Uint)str_.size();
+	out.resize(size);
+	Uint in = 0;
+	Uint outPos = 0;
+	while (in < size) {
+		Uint len = Utf8Scan::asciiCaseCopy(str_.data() + in, size - in, &out[outPos], upperNotLower ? 'a' : 'A');
+		in += len;
+		outPos += len;
+		if (in < size) {
+			Char ch = Char::fromUtf8(str_.c_str() + in, len);
+			ASSERT(!ch.isEof());
+			in += len;
+			Char converted = upperNotLower ? ch.toUpperCopy() : ch.toLowerCopy();
+			char utf8[4];
+			Uint utf8Len = converted.toUtf8(utf8);
+			if (outPos + utf8Len + (size - in) > out.size()) {
+				out.resize(outPos + utf8Len + (size - in));
+			}
+			memcpy(&out[outPos], utf8, utf8Len);
+			outPos += utf8Len;
+		}
 	}
+	out.resize(outPos);
 	return ret;
 }
 
@@ -292,15 +402,34 @@ bool String::caselessEquals(const String& other) const {
 	if (str_.size() != other.str_.size()) {
 		return false;
 	}
-	StringIter it1 = begin();
-	StringIter it2 = other.begin();
-
-	for (; !it1.atEnd() && !it2.atEnd(); ++it1, ++it2) {
-		if ((*it1 != *it2) && (it1->toUpperCopy() != it2->toUpperCopy())) {
+	Uint pos1 = 0;
+	Uint pos2 = 0;
+	return caselessMatch(other, pos1, pos2) && (pos1 == str_.size()) && (pos2 == other.str_.size());
+}
+
+bool String::caselessMatch(const String& other, Uint& pos1, Uint& pos2) const {
+	// Runs of ASCII are compared in bulk and other characters one at a time.
+	Uint size1 = (Uint)str_.size();
+	Uint size2 = (Uint)other.str_.size();
+	while ((pos1 < size1) && (pos2 < size2)) {
+		Uint len = Utf8Scan::asciiCaselessPrefixLength(str_.data() + pos1, other.str_.data() + pos2,
+			std::min(size1 - pos1, size2 - pos2));
+		pos1 += len;
+		pos2 += len;
+		if ((pos1 == size1) || (pos2 == size2)) {
+			break;
+		}
+		Uint len1 = 0;
+		Uint len2 = 0;
+		Char ch1 = Char::fromUtf8(str_.c_str() + pos1, len1);
+		Char ch2 = Char::fromUtf8(other.str_.c_str() + pos2, len2);
+		if ((ch1 != ch2) && (ch1.toUpperCopy() != ch2.toUpperCopy())) {
 			return false;
 		}
+		pos1 += len1;
+		pos2 += len2;
 	}
-	return it1.atEnd() && it2.atEnd();
+	return true;
 }
 
 bool String::beginsWith(const String& other) const {
@@ -309,7 +438,7 @@ bool String::beginsWith(const String& other) const {
 	if (thisSize < otherSize) {
 		return false;
 	}
-	return str_.substr(0, otherSize) == other.str_;
+	return str_.compare(0, otherSize, other.str_) == 0;
 }
 
 bool String::endsWith(const String& other) const {
@@ -318,19 +447,13 @@ bool String::endsWith(const String& other) const {
 	if (thisSize < otherSize) {
 		return false;
 	}
-	return str_.substr(thisSize - otherSize, otherSize) == other.str_;
+	return str_.compare(thisSize - otherSize, otherSize, other.str_) == 0;
 }
 
 bool String::caselessBeginsWith(const String& other) const {
-	StringIter it1 = begin();
-	StringIter it2 = other.begin();
-
-	for (; !it1.atEnd() && !it2.atEnd(); ++it1, ++it2) {
-		if ((*it1 != *it2) && (it1->toUpperCopy() != it2->toUpperCopy())) {
-			return false;
-		}
-	}
-	return it2.atEnd();
+	Uint pos1 = 0;
+	Uint pos2 = 0;
+	return caselessMatch(other, pos1, pos2) && (pos2 == other.str_.size());
 }
 
 String String::trimCopy() const {
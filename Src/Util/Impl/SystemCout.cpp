@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include "Util/Assert.hpp"
@@ -5,37 +6,115 @@
 #include "Util/SystemCout.hpp"
 #include "Util/Windows.hpp"
 
+#if BUILD(LINUX)
+#include <unistd.h>
+#endif
+
+namespace {
+	// The output stream which captures the output of the current thread or null.
+	thread_local OutputStream* threadCapture = nullptr;
+}
+
 SystemCout::SystemCout() : 
 	OutputStream(),
-	converter_()
+	converter_(),
+	mutex_(),
+	buffer_(),
+	lineFlush_(isConsoleOutput())
 {
 #if BUILD(WINDOWS)
 	converter_ = CharOutputConverter::create(
-		isConsoleOutput() ? CharEncoding::OEM : CharEncoding::ANSI);
+		lineFlush_ ? CharEncoding::OEM : CharEncoding::ANSI);
 #else
 	// Linux etc use UTF8.
 	converter_ = CharOutputConverter::create(CharEncoding::UTF8);
 #endif
+	buffer_.reserve(BUFFER_SIZE);
 }
 
 SystemCout::~SystemCout() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	writeBuffer();
 }
 
 void SystemCout::streamChar(Char ch) {
+	if (threadCapture != nullptr) {
+		threadCapture->streamChar(ch);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	appendChar(ch);
+	if ((buffer_.size() >= BUFFER_SIZE) || (lineFlush_ && (ch == Char('\n')))) {
+		writeBuffer();
+	}
+}
+
+void SystemCout::streamUtf8(const char* s, Uint len) {
+	if (threadCapture != nullptr) {
+		threadCapture->streamUtf8(s, len);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::string::size_type oldSize = buffer_.size();
+	if (!converter_->convertAppendUtf8(s, len, buffer_)) {
+		// There has been an encoding error. Convert again one character at
+		// a time to output '?' for each character which cannot be encoded.
+		buffer_.resize(oldSize);
+		Uint pos = 0;
+		while (pos < len) {
+			Uint charLen = 0;
+			Char ch = Char::fromUtf8(s + pos, charLen);
+			ASSERT(!ch.isEof() && (charLen <= len - pos));
+			appendChar(ch);
+			pos += charLen;
+		}
+	}
+	if ((buffer_.size() >= BUFFER_SIZE) || 
+		(lineFlush_ && (buffer_.find('\n', oldSize) != std::string::npos))) {
+		writeBuffer();
+	}
+}
+
+void SystemCout::flush() {
+	if (threadCapture != nullptr) {
+		threadCapture->flush();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	writeBuffer();
+}
+
+void SystemCout::appendChar(Char ch) {
 	char buf[CharOutputConverter::MAX_OUTPUT_CHAR_BYTES];
 	Uint size = converter_->convertChar(ch, buf);
-
 	if (size == 0) {
 		// There has been an encoding error. Just output '?'.
-		std::cout << '?';
+		buffer_ += '?';
 	}
 	else {
-		for (Uint i = 0; i < size; ++i) {
-			std::cout << buf[i];
-		}
+		buffer_.append(buf, size);
 	}
 }
 
+void SystemCout::writeBuffer() {
+	// std::cout is synchronised with stdio so writing to stdout keeps the
+	// order with anything already written to std::cout.
+	if (!buffer_.empty()) {
+		fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+		buffer_.clear();
+	}
+	fflush(stdout);
+}
+
+OutputStream* SystemCout::setThreadCapture(OutputStream* capture) {
+	OutputStream* ret = threadCapture;
+	threadCapture = capture;
+	return ret;
+}
+
 #if BUILD(WINDOWS)
 bool SystemCout::isConsoleOutput() {
 	// Get the stdout handle
@@ -57,6 +136,12 @@ bool SystemCout::isConsoleOutput() {
 	BOOL status = GetConsoleMode(stdHandle, &consoleMode);
 	return (status != 0);
 }
+#elif BUILD(LINUX)
+bool SystemCout::isConsoleOutput() {
+	return isatty(STDOUT_FILENO) != 0;
+}
+#else
+#error "Illegal build"
 #endif
 
 // Global objects
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Util/Assert.hpp"
+#include "Util/WorkStealingPool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Local
+///////////////////////////////////////////////////////////////////////////////
+
+// The range of task indices still to be started by one thread.
+struct WorkStealingTaskRange {
+	WorkStealingTaskRange() : mutex(), begin(0), end(0) { }
+	std::mutex mutex;
+	Uint begin;
+	Uint end;
+};
+
+// Get the next task for a thread, stealing if its own range is empty.
+// Returns false if there are no tasks left to start.
+static bool nextTask(std::vector<WorkStealingTaskRange>& ranges, Uint thread, Uint& index) {
+	WorkStealingTaskRange& own = ranges[thread];
+	{
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.begin < own.end) {
+			index = own.begin++;
+			return true;
+		}
+	}
+
+	Uint threadCount = (Uint)ranges.size();
+	for (Uint i = 1; i < threadCount; i++) {
+		WorkStealingTaskRange& victim = ranges[(thread + i) % threadCount];
+		Uint begin;
+		Uint end;
+		{
+			// Take the back half (rounded up) of the victim's range
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.begin == victim.end) {
+				continue;
+			}
+			end = victim.end;
+			begin = end - (end - victim.begin + 1) / 2;
+			victim.end = begin;
+		}
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			own.begin = begin + 1;
+			own.end = end;
+		}
+		index = begin;
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// WorkStealingPool
+///////////////////////////////////////////////////////////////////////////////
+
+Uint WorkStealingPool::defaultThreadCount() {
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void WorkStealingPool::run(Uint taskCount, Uint threadCount, const TaskFunc& func) {
+	ASSERT(threadCount > 0);
+	threadCount = std::min(threadCount, std::max(taskCount, 1u));
+	if (threadCount == 1) {
+		for (Uint i = 0; i < taskCount; i++) {
+			func(i, 0);
+		}
+		return;
+	}
+
+	// Share out the tasks
+	std::vector<WorkStealingTaskRange> ranges(threadCount);
+	for (Uint t = 0; t < threadCount; t++) {
+		ranges[t].begin = (Uint)((Uint64)taskCount * t / threadCount);
+		ranges[t].end = (Uint)((Uint64)taskCount * (t + 1) / threadCount);
+	}
+
+	std::atomic<bool> stop(false);
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	auto worker = [&](Uint thread) {
+		Uint index;
+		while (!stop && nextTask(ranges, thread, index)) {
+			try {
+				func(index, thread);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+				stop = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (Uint t = 1; t < threadCount; t++) {
+		threads.push_back(std::thread(worker, t));
+	}
+	worker(0);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include "Util/Char.hpp"
 
+class String;
+
 // A interface which allows Char objects to be streamed.
 class OutputStream {
 public:
@@ -9,6 +11,18 @@ public:
 	
 	// Override this to perform the streaming on characters
 	virtual void streamChar(Char ch) = 0;
+
+	// Stream "len" bytes of UTF8 from "s" which must be valid UTF8. The
+	// default calls streamChar() for each character. Override this if UTF8
+	// can be streamed in bulk.
+	virtual void streamUtf8(const char* s, Uint len);
+
+	// Stream a whole string. The default calls streamUtf8() with the UTF8
+	// of the string.
+	virtual void streamString(const String& s);
+
+	// Write out any output which has been buffered. The default does nothing.
+	virtual void flush() { }
 };
 
 // Streaming boolean values is not allowed (assertion error)
@@ -38,3 +52,11 @@ inline OutputStream& operator<<(OutputStream& os, SendlType) {
 	return os;
 }
 
+// sflush is the manipulator which writes out any buffered output.
+enum SflushType { sflush };
+
+inline OutputStream& operator<<(OutputStream& os, SflushType) {
+	os.flush();
+	return os;
+}
+
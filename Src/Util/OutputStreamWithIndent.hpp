@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #include "Util/Assert.hpp"
 #include "Util/OutputStream.hpp"
 
@@ -36,6 +37,25 @@ public:
 		}
 		os_.streamChar(ch);
 	}
+	void streamUtf8(const char* s, Uint len) {
+		// Stream a line at a time indenting those which are not empty
+		while (len > 0) {
+			const char* newline = (const char*)memchr(s, '\n', len);
+			Uint lineLen = (newline != nullptr) ? (Uint)(newline - s) + 1 : len;
+			if (atStartOfLine_ && (*s != '\n')) {
+				for (Uint i = 0; i < indentLevel_; ++i) {
+					os_.streamChar(Char('\t'));
+				}
+			}
+			os_.streamUtf8(s, lineLen);
+			atStartOfLine_ = (newline != nullptr);
+			s += lineLen;
+			len -= lineLen;
+		}
+	}
+	void flush() {
+		os_.flush();
+	}
 	void increaseIndent() {
 		++indentLevel_;
 	}
@@ -1,5 +1,9 @@
 #pragma once
+#include <atomic>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include "Util/Char.hpp"
 #include "Util/Def.hpp"
 #include "Util/OutputStream.hpp"
@@ -130,8 +134,12 @@ typedef std::string PlatformString;
 // a std::vector of Char.
 //
 // The implication of this is that the String class does not know where its characters
-// are without iterating through the underlying std::string. So the String class does
-// not provide a size() function or [] indexing.
+// are without iterating through the underlying std::string. The size(), at() and
+// iterAt() functions build an index of character positions on first use so that
+// they are fast on later calls. The index is discarded when the string is modified
+// so these functions are best used on strings which are read many times. The const
+// functions may be called from several threads at once on a shared String since
+// the index is published atomically (if two threads build it one copy is dropped).
 //
 // Any char* and std::string arguments must be encoded as UTF8. All such inputs are
 // validated and there is an assertion error if they are not valid Unicode. So it is
@@ -148,12 +156,16 @@ public:
 	// Copy constructor.
 	String(const String& s) : str_(s.str_) { }
 
+	// Move constructor. The moved from string is left empty.
+	String(String&& s) noexcept : str_(std::move(s.str_)), index_(std::move(s.index_)) { s.str_.clear(); }
+
 	// Construct from a null terminated UTF8 string (which must not contain
 	// any null characters) and must be valid UTF8.
 	String(const char* s) : str_(s) { validate(str_); }
 	
 	// Construct from a UTF8 string which must be valid UTF8.
 	explicit String(const std::string& s) : str_(s) { validate(str_); }
+	explicit String(std::string&& s) : str_(std::move(s)) { validate(str_); }
 
 	// Construct from a single character which must not be EOF.
 	String(Char ch) : str_() { operator+=(ch); }
@@ -162,11 +174,21 @@ public:
 	// up to but not including "to".
 	String(const StringIter& from, const StringIter& to);
 
-	// Assignment
-	String& operator=(const String& s) { str_ = s.str_; return *this; }
+	// Assignment. The moved from string is left empty.
+	String& operator=(const String& s) { index_.reset(); str_ = s.str_; return *this; }
+	String& operator=(String&& s) noexcept {
+		if (this != &s) {
+			str_ = std::move(s.str_);
+			index_ = std::move(s.index_);
+			s.str_.clear();
+		}
+		return *this;
+	}
 
-	// OutputStream virtual method
+	// OutputStream virtual methods
 	void streamChar(Char ch) { operator+=(ch); }
+	void streamUtf8(const char* s, Uint len) { index_.reset(); str_.append(s, len); }
+	void streamString(const String& s) { operator+=(s); }
 
 	// Iterators to the beginning and end of the string
 	StringIter begin() const { return StringIter(*this, 0); }
@@ -178,21 +200,44 @@ public:
 	Char back() const;
 
 	// Clear
-	void clear() { str_.clear(); }
+	void clear() { index_.reset(); str_.clear(); }
 
 	// Size
 	bool empty() const { return str_.empty(); }
 
+	// The number of characters in the string. The first call after the string
+	// is modified takes time proportional to the length of the string. Later
+	// calls are constant time.
+	//
+	// The index is built on first use but, as for the other const functions,
+	// this is still safe on a String shared between threads.
+	Uint size() const { return getIndex().size; }
+
+	// The character at character position "pos" which must be less than size().
+	// Constant time once the index has been built.
+	Char at(Uint pos) const;
+
+	// An iterator at character position "pos" which must not be greater than
+	// size(). iterAt(size()) is the same as end(). Constant time once the
+	// index has been built.
+	StringIter iterAt(Uint pos) const;
+
 	// Reserve space for at least "capacity" characters
 	void reserve(Uint capacity) { str_.reserve(4 * capacity); }
 
 	// Append. If a single character then must not be EOF.
-	String& operator+=(const String& s) { str_ += s.str_; return *this; }
+	String& operator+=(const String& s) { index_.reset(); str_ += s.str_; return *this; }
 	String& operator+=(Char ch);
 
-	// Concatenation
-	String operator+(const String& s) const { String ret = *this; ret += s; return ret; }
-	String operator+(Char ch) const { String ret = *this; ret += ch; return ret; }
+	// Concatenation. When either side is a temporary its buffer is reused
+	// rather than copied so chains such as a + "x" + b + "y" only allocate
+	// as the result grows.
+	String operator+(const String& s) const & { String ret = *this; ret += s; return ret; }
+	String operator+(const String& s) && { String ret = std::move(*this); ret += s; return ret; }
+	String operator+(String&& s) const & { s.modifyUtf8().insert(0, str_); return std::move(s); }
+	String operator+(String&& s) && { String ret = std::move(*this); ret += s; return ret; }
+	String operator+(Char ch) const & { String ret = *this; ret += ch; return ret; }
+	String operator+(Char ch) && { String ret = std::move(*this); ret += ch; return ret; }
 
 	// Find first. The returned string positions point to the beginning and one beyond
 	// the end of the first occurrence of a substring which matches the argument.
@@ -220,12 +265,18 @@ public:
 	bool operator>(const String& other) const { return str_ > other.str_; }
 	bool operator>=(const String& other) const { return str_ >= other.str_; }
 
-	// Output as UTF8.
-	std::string toUtf8() const { return str_; }
+	// Output as UTF8. A temporary string gives up its buffer.
+	std::string toUtf8() const & { return str_; }
+	std::string toUtf8() && { return std::move(str_); }
 
 	// Output to a platform string so that it can be used by the underlying
 	// operating system.
 	PlatformString toPlatform() const;
+
+	// Construct from a platform string returned by the underlying operating
+	// system. For Windows compilers any unpaired UTF16 surrogate is replaced
+	// by U+FFFD. Otherwise the string must be valid UTF8.
+	static String fromPlatform(const PlatformString& s);
 	
 	// Convert string to uppercase
 	String toUpperCopy() const;
@@ -254,6 +305,72 @@ public:
 	size_t hash() const { return std::hash<std::string>()(str_); }
 
 private:
+	// The index of character positions. Every INDEX_INTERVAL'th character has its
+	// byte position recorded so that finding any character only needs to step
+	// over at most INDEX_INTERVAL - 1 others.
+	static const Uint INDEX_INTERVAL = 32;
+	struct Index {
+		Uint size;					// The number of characters
+		std::vector<Uint> marks;	// Byte positions of characters 0, INDEX_INTERVAL, 2 * INDEX_INTERVAL etc.
+									// (empty if all the characters are ASCII)
+	};
+
+	// Owner of the index. The index is built by const functions so it is set
+	// with a compare and exchange to allow a shared String to be read by
+	// several threads. Modifying the String is not thread safe as usual.
+	class IndexPtr {
+	public:
+		IndexPtr() : ptr_(nullptr) { }
+		IndexPtr(IndexPtr&& other) noexcept : ptr_(other.ptr_.exchange(nullptr)) { }
+		~IndexPtr() { delete ptr_.load(); }
+		IndexPtr& operator=(IndexPtr&& other) noexcept { reset(other.ptr_.exchange(nullptr)); return *this; }
+
+		// Get the index or null if it has not been built.
+		const Index* get() const { return ptr_.load(std::memory_order_acquire); }
+
+		// Set the index unless another thread has already set it and return
+		// the index which is set.
+		const Index* publish(std::unique_ptr<Index> index) {
+			Index* expected = nullptr;
+			if (ptr_.compare_exchange_strong(expected, index.get(), std::memory_order_acq_rel)) {
+				return index.release();
+			}
+			return expected;
+		}
+
+		// Discard the index (replacing it with "index" which may be null).
+		// The String is being modified so no other thread can be using it and
+		// a relaxed load is enough to skip the exchange when there is no index.
+		void reset(Index* index = nullptr) {
+			if ((index != nullptr) || (ptr_.load(std::memory_order_relaxed) != nullptr)) {
+				delete ptr_.exchange(index);
+			}
+		}
+
+	private:
+		std::atomic<Index*> ptr_;
+	};
+
+	// Copy the string converting to uppercase or lowercase.
+	String caseCopy(bool upperNotLower) const;
+
+	// Compare with other ignoring case starting at byte positions pos1 (in
+	// this string) and pos2 (in other). Stops at the end of either string and
+	// returns true or at the first characters which differ and returns false.
+	// pos1 and pos2 are updated to the byte positions reached.
+	bool caselessMatch(const String& other, Uint& pos1, Uint& pos2) const;
+
+	// Get the index, building it if necessary.
+	const Index& getIndex() const;
+
+	// Get the byte position within str_ of character position "pos" which must
+	// not be greater than size().
+	Uint bytePosition(Uint pos) const;
+
+	// Get the underlying UTF8 string for modification by friend classes. Any
+	// index is discarded.
+	std::string& modifyUtf8() { index_.reset(); return str_; }
+
 	// Check that the UTF8 string supplied as input is valid and assert if not.
 	static void validate(const std::string& s);
 
@@ -262,15 +379,18 @@ private:
 	static Uint validate(const char* s);
 
 private:
+	friend class CharOutputConverter;
+	friend class FileEncodedInput;
+	friend class OutputStream;
 	friend class StringIter;
+	friend class Utf8CharInputConverter;
 	std::string str_;
+	mutable IndexPtr index_;	// Index of character positions or null if not built
 };
 
 // Allow streaming to an OutputStream object.
 inline OutputStream& operator<<(OutputStream& os, const String& s) {
-	for (StringIter pos = s.begin(); !pos.atEnd(); pos++) {
-		os.streamChar(*pos);
-	}
+	os.streamString(s);
 	return os;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <mutex>
+#include <string>
 #include "Util/Def.hpp"
 #include "Util/OutputStream.hpp"
 #include "Util/OutputStreamWithIndent.hpp"
@@ -17,6 +19,11 @@ DPTR(CharOutputConverter);
 // (or 7 bit ASCII which is subset of this). The end of line is
 // output with scout << sendl.
 
+// The output is buffered and written with a single call when the buffer is
+// full, at the end of each line if the standard output is a terminal, on
+// scout << sflush and when the program exits. Anything written directly to
+// std::cout should be preceded by scout << sflush to keep the order.
+
 // An alternative named "icout" is the same but supports indenting
 // and is for debugging only.
 
@@ -24,18 +31,39 @@ class SystemCout : public OutputStream {
 public:
 	SystemCout();
 	~SystemCout();
+
+	// OutputStream virtual methods
 	void streamChar(Char ch);
+	void streamUtf8(const char* s, Uint len);
+	void flush();
+
+	// The size of the output buffer
+	static const Uint BUFFER_SIZE = 16 * 1024;
+
+	// Redirect all scout output from the calling thread to "capture" instead
+	// of the standard output. Setting null restores the standard output. This
+	// keeps the output from different threads separate so that it can be
+	// output later in a fixed order. Returns the previous capture (or null)
+	// so that it can be restored.
+	static OutputStream* setThreadCapture(OutputStream* capture);
 
 private:
-#if BUILD(WINDOWS)
 	// Determine if the std::cout output is going to the console
-	// window or has been redirected somewhere else. If there are
-	// any internal errors then these return true.
+	// window or terminal or has been redirected somewhere else. If there
+	// are any internal errors then these return true.
 	bool isConsoleOutput();
-#endif
+
+	// Convert a character and add it to the buffer. The mutex must be locked.
+	void appendChar(Char ch);
+
+	// Write out and empty the buffer. The mutex must be locked.
+	void writeBuffer();
 
 private:
 	CharOutputConverterPtr converter_;
+	std::mutex mutex_;		// Guards the buffer
+	std::string buffer_;	// Output bytes not yet written
+	bool lineFlush_;		// True to write out the buffer at the end of each line
 };
 
 // Global object
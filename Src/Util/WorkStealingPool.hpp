@@ -0,0 +1,26 @@
+#pragma once
+#include <functional>
+#include "Util/Def.hpp"
+
+// Runs a set of independent tasks in parallel on a number of threads. Tasks
+// are identified by an index from 0 to taskCount - 1. Each thread starts with
+// an equal contiguous share of the indices and takes tasks from the front of
+// its share. When a thread runs out it steals the back half of the share of
+// another thread, so uneven task sizes still keep all the threads busy.
+class WorkStealingPool {
+public:
+	// The task function. index is the task index and thread is the index of
+	// the thread running it (from 0 to threadCount - 1) which can be used to
+	// select per-thread storage without locking.
+	typedef std::function<void(Uint index, Uint thread)> TaskFunc;
+
+	// Get the default number of threads which is the hardware concurrency.
+	static Uint defaultThreadCount();
+
+	// Run all the tasks using threadCount threads (which must be non-zero) and
+	// wait for them to complete. The calling thread is used as thread 0. With
+	// one thread the tasks are run in index order on the calling thread.
+	// If a task throws an exception then no further tasks are started and the
+	// first exception is rethrown once all the threads have stopped.
+	static void run(Uint taskCount, Uint threadCount, const TaskFunc& func);
+};
@@ -0,0 +1,80 @@
+#include <string>
+#include <vector>
+#include "TestTool/TestBenchmark.hpp"
+#include "TestTool/TestUtil.hpp"
+#include "Util/Char.hpp"
+#include "Util/String.hpp"
+
+// Microbenchmarks of the Char classification, case conversion and decoding
+// functions over text which is mostly ASCII source code with some non-ASCII
+// identifiers and comments.
+namespace {
+	std::string sourceText() {
+		std::string text;
+		while (text.size() < 64 * 1024) {
+			text += "int caf\xc3\xa9" "Count = 0x1f; // \xe2\x82\xac price in \xce\xb1\xce\xb2\xce\xb3\r\n";
+			text += "\tfor (int i = 0; i < 10; i++) { total += values[i] * 3; }\r\n";
+		}
+		return text;
+	}
+}
+
+AUTO_BENCHMARK {
+	String text(sourceText());
+	CHECK(!text.findFirst(String("caf") + Char::fromUtf32(0xe9) + "Count").atEnd());
+	while (state.keepRunning()) {
+		Uint identifierCount = 0;
+		Uint whitespaceCount = 0;
+		for (StringIter it = text.begin(); !it.atEnd(); ++it) {
+			identifierCount += it->isPpIdentifier() ? 1 : 0;
+			whitespaceCount += it->isWhitespace() ? 1 : 0;
+		}
+		doNotOptimize(identifierCount);
+		doNotOptimize(whitespaceCount);
+	}
+	state.setBytesPerIteration(text.toUtf8().size());
+}
+
+// Classify characters spread over the whole Basic Multilingual Plane which
+// are already decoded so that only the classification is timed.
+AUTO_BENCHMARK {
+	std::vector<Char> chars;
+	for (Uint32 i = 0; i < 64 * 1024; i++) {
+		Char ch = Char::fromUtf32((i * 40503u) & 0xffffu);
+		chars.push_back(ch.isEof() ? Char('x') : ch);
+	}
+	while (state.keepRunning()) {
+		Uint identifierCount = 0;
+		for (Char ch : chars) {
+			identifierCount += ch.isPpIdentifier() ? 1 : 0;
+		}
+		doNotOptimize(identifierCount);
+	}
+}
+
+AUTO_BENCHMARK {
+	String text(sourceText());
+	while (state.keepRunning()) {
+		Uint upperCount = 0;
+		for (StringIter it = text.begin(); !it.atEnd(); ++it) {
+			upperCount += it->toUpperCopy().isUpper() ? 1 : 0;
+		}
+		doNotOptimize(upperCount);
+	}
+	state.setBytesPerIteration(text.toUtf8().size());
+}
+
+AUTO_BENCHMARK {
+	std::string text = sourceText();
+	while (state.keepRunning()) {
+		Uint charCount = 0;
+		for (Uint pos = 0; pos < text.size(); ) {
+			Uint len;
+			Char ch = Char::fromUtf8(text.data() + pos, len);
+			pos += len;
+			charCount += ch.isEof() ? 0 : 1;
+		}
+		doNotOptimize(charCount);
+	}
+	state.setBytesPerIteration(text.size());
+}
@@ -1,3 +1,5 @@
+#include <string>
+#include <vector>
 #include "Util/CharInputConverter.hpp"
 #include "TestTool/TestUtil.hpp"
 
@@ -104,6 +106,48 @@ AUTO_TEST_CASE {
 	CHECK(cv->convertChar("\xf0\xa4\xad", 3u) == std::make_pair(3u, Char::eof()));
 }
 
+// UTF8 bulk conversion
+namespace {
+	class CountingErrorHandler : public CharInputConverterErrorHandler {
+	public:
+		CountingErrorHandler() : count_(0) { }
+		void cannotEncodeForInput(const std::string& hexChar) { ++count_; }
+		Uint count_;
+	};
+}
+
+AUTO_TEST_CASE {
+	std::shared_ptr<CountingErrorHandler> errorHandler = std::make_shared<CountingErrorHandler>();
+	CharInputConverterPtr cv = CharInputConverter::create(CharEncoding::UTF8, errorHandler, Char('?'));
+
+	// Long runs of ASCII either side of multi-byte characters so that the
+	// vectorised scan crosses several block boundaries.
+	std::string ascii = "The quick brown fox jumps over the lazy dog 0123456789.";
+	std::string src = ascii + "\xc2\xa2" + ascii + ascii + "\xe2\x82\xac\xf0\xa4\xad\xa2" + ascii;
+	String dst = "fred";
+	cv->convertAppend(src, dst);
+	CHECK(dst.toUtf8() == "fred" + src);
+	CHECK(errorHandler->count_ == 0);
+
+	// Invalid bytes in the middle of ASCII runs and a partial character at the end
+	std::string bad = ascii + "\xa4\xad" + ascii + "\xc2" + ascii + "\xf0\xa4\xad";
+	dst = "fred";
+	cv->convertAppend(bad, dst);
+	CHECK(dst.toUtf8() == "fred" + ascii + "??" + ascii + "?" + ascii + "?");
+	CHECK(errorHandler->count_ == 4);
+
+	// The bulk conversion must agree with the character by character conversion
+	// for every split point of a mixed buffer.
+	std::string mixed = ascii + "\xc2\xa2\xa4" + ascii + "\xe2\x82\xac\xed\xa0\x80\xf0\xa4\xad\xa2" + ascii;
+	for (Uint len = 0; len <= mixed.size(); len++) {
+		String bulk;
+		String single;
+		cv->convertAppend(mixed.c_str(), len, bulk);
+		cv->CharInputConverter::convertAppend(mixed.c_str(), len, single);
+		CHECK(bulk == single);
+	}
+}
+
 // UTF16BE
 AUTO_TEST_CASE {
 	CharInputConverterPtr cv = CharInputConverter::create(CharEncoding::UTF16BE, CharInputConverterErrorHandlerPtr(), Char::eof());
@@ -164,3 +208,84 @@ AUTO_TEST_CASE {
 	CHECK(cv->convertChar("\x1e\xd1\x01\x00\x7a\x00\x00\x00", 8u) == std::make_pair(4u, Char::fromUtf32(0x1d11e)));
 	CHECK(cv->convertChar("\x7a\x00\x00\x00", 4u) == std::make_pair(4u, Char('z')));
 }
+
+// UTF16 and UTF32 bulk conversion
+namespace {
+	// Append the unit u of size bytes to s in big or little endian order.
+	void appendUnit(std::string& s, Uint32 u, Uint size, bool isBigEndian) {
+		for (Uint i = 0; i < size; i++) {
+			Uint shift = 8u * (isBigEndian ? size - 1u - i : i);
+			s += (char)(Uint8)(u >> shift);
+		}
+	}
+
+	// Check that the bulk conversion agrees with the character by character
+	// conversion, including the errors reported, for every split point of src.
+	void checkBulkConversion(CharEncoding encoding, const std::string& src) {
+		std::shared_ptr<CountingErrorHandler> bulkErrors = std::make_shared<CountingErrorHandler>();
+		std::shared_ptr<CountingErrorHandler> singleErrors = std::make_shared<CountingErrorHandler>();
+		CharInputConverterPtr bulkCv = CharInputConverter::create(encoding, bulkErrors, Char('?'));
+		CharInputConverterPtr singleCv = CharInputConverter::create(encoding, singleErrors, Char('?'));
+		for (Uint len = 0; len <= src.size(); len++) {
+			String bulk = "fred";
+			String single = "fred";
+			bulkCv->convertAppend(src.c_str(), len, bulk);
+			singleCv->CharInputConverter::convertAppend(src.c_str(), len, single);
+			CHECK(bulk == single);
+			CHECK(bulkErrors->count_ == singleErrors->count_);
+
+			bulk = "fred";
+			single = "fred";
+			Uint bulkUsed = bulkCv->convertAppendAvailable(src.c_str(), len, bulk);
+			Uint singleUsed = singleCv->CharInputConverter::convertAppendAvailable(src.c_str(), len, single);
+			CHECK(bulkUsed == singleUsed);
+			CHECK(bulk == single);
+			CHECK(bulkErrors->count_ == singleErrors->count_);
+		}
+	}
+}
+
+AUTO_TEST_CASE {
+	// Long runs of ASCII either side of other characters so that the vectorised
+	// conversion crosses several block boundaries.
+	std::string ascii = "The quick brown fox jumps over the lazy dog 0123456789.";
+	const std::vector<std::vector<Uint32>> others = {
+		{ 0x00a2 }, { 0x20ac }, { 0x6c34 }, { 0xd834, 0xdd1e }, { 0x00e9 }, { 0xd800 },
+		{ 0x0041 }, { 0xdc00 }, { 0xdbff, 0xdfff }, { 0xdbff, 0xdbff }, { 0xffff }
+	};
+	for (bool isBigEndian : { false, true }) {
+		std::string utf16;
+		std::string utf32;
+		for (const std::vector<Uint32>& units : others) {
+			for (char ch : ascii) {
+				appendUnit(utf16, (Uint8)ch, 2u, isBigEndian);
+				appendUnit(utf32, (Uint8)ch, 4u, isBigEndian);
+			}
+			for (Uint32 unit : units) {
+				appendUnit(utf16, unit, 2u, isBigEndian);
+				appendUnit(utf32, unit, 4u, isBigEndian);
+			}
+		}
+		// Some characters outside the Basic Multilingual Plane and invalid UTF32
+		appendUnit(utf32, 0x1d11e, 4u, isBigEndian);
+		appendUnit(utf32, 0x10ffff, 4u, isBigEndian);
+		appendUnit(utf32, 0x110000, 4u, isBigEndian);
+		appendUnit(utf32, 0xffffffff, 4u, isBigEndian);
+		appendUnit(utf32, 0x7a, 4u, isBigEndian);
+
+		CharEncoding encoding16 = isBigEndian ? CharEncoding::UTF16BE : CharEncoding::UTF16LE;
+		CharEncoding encoding32 = isBigEndian ? CharEncoding::UTF32BE : CharEncoding::UTF32LE;
+		checkBulkConversion(encoding16, utf16);
+		checkBulkConversion(encoding32, utf32);
+
+		// The pairs d834 dd1e and dbff dfff are U+1d11e and U+10ffff. The other
+		// surrogates are errors.
+		std::shared_ptr<CountingErrorHandler> errorHandler = std::make_shared<CountingErrorHandler>();
+		String dst = CharInputConverter::create(encoding16, errorHandler, Char('?'))->convertString(utf16);
+		CHECK(dst.toUtf8() ==
+			ascii + "\xc2\xa2" + ascii + "\xe2\x82\xac" + ascii + "\xe6\xb0\xb4" + ascii + "\xf0\x9d\x84\x9e" +
+			ascii + "\xc3\xa9" + ascii + "?" + ascii + "A" + ascii + "?" + ascii + "\xf4\x8f\xbf\xbf" + ascii + "??" + ascii + "\xef\xbf\xbf");
+		CHECK(errorHandler->count_ == 4);
+	}
+}
+
@@ -150,3 +150,30 @@ AUTO_TEST_CASE {
 	testChar(cv, Char::fromUtf32(0x6c34), "\x34\x6c\x00\x00");
 	testChar(cv, Char::fromUtf32(0x1d11e), "\x1e\xd1\x01\x00");
 }
+
+// Converting a whole string in bulk gives the same bytes as converting one
+// character at a time. The string is long enough to be converted in several
+// blocks with characters of every UTF8 length on the block boundaries.
+AUTO_TEST_CASE {
+	String src;
+	const Uint32 samples[] = { 'a', 0xe9, 0x6c34, 0x1d11e, '\n' };
+	for (Uint i = 0; i < 3000; i++) {
+		src += Char::fromUtf32(samples[(i * 7 + i / 5) % 5]);
+	}
+	const CharEncoding encodings[] = { 
+		CharEncoding::UTF8, CharEncoding::UTF16BE, CharEncoding::UTF16LE, CharEncoding::UTF32BE, CharEncoding::UTF32LE };
+	for (const CharEncoding& encoding : encodings) {
+		CharOutputConverterPtr cv = CharOutputConverter::create(encoding);
+		std::string expected = "x";
+		char buf[CharOutputConverter::MAX_OUTPUT_CHAR_BYTES];
+		for (StringIter pos = src.begin(); !pos.atEnd(); ++pos) {
+			expected.append(buf, cv->convertChar(*pos, buf));
+		}
+		std::string dst = "x";
+		CHECK(cv->convertAppend(src, dst));
+		CHECK(dst == expected);
+		dst = "x";
+		CHECK(cv->convertAppendUtf8("", 0, dst));
+		CHECK(dst == "x");
+	}
+}
@@ -224,6 +224,29 @@ AUTO_TEST_CASE {
 	CHECK(Char::hexDigit(15, false) == 'f');
 }
 
+// Test the Pp identifier characters at the edges of the pages and ranges
+AUTO_TEST_CASE {
+	const char32_t identifiers[] = { 0xc0u, 0xd6u, 0xd8u, 0xffu, 0x100u, 0x3b1u, 0x4e00u, 0x4effu, 0x9f00u, 0x9fa5u, 0xffdcu };
+	for (char32_t value : identifiers) {
+		Char ch = Char::fromUtf32(value);
+		CHECK(ch.isPpIdentifier());
+		CHECK(!ch.isLetter());
+		CHECK(!ch.isBasicSource());
+		CHECK(!ch.isAscii());
+	}
+	const char32_t others[] = { 0x80u, 0xbfu, 0xd7u, 0x20acu, 0x4dffu, 0x9fa6u, 0x9fffu, 0xffddu, 0xffffu, 0x10000u, 0x24b62u };
+	for (char32_t value : others) {
+		Char ch = Char::fromUtf32(value);
+		CHECK(!ch.isPpIdentifier());
+		CHECK(!ch.isWhitespace());
+		CHECK(!ch.isHexDigit());
+	}
+	CHECK(Char('_').isPpIdentifier());
+	CHECK(!Char('$').isPpIdentifier());
+	CHECK(!Char::eof().isPpIdentifier());
+	CHECK(!Char::eof().isUpper());
+}
+
 // Test all Unicode characters
 AUTO_TEST_CASE {
 	for (char32_t value = 0u; value < 0x10ffffu + 16u; value++) {
@@ -0,0 +1,75 @@
+#include <string>
+#include "TestTool/TestBenchmark.hpp"
+#include "TestTool/TestUtil.hpp"
+#include "Util/CharInputConverter.hpp"
+#include "Util/CharOutputConverter.hpp"
+#include "Util/String.hpp"
+
+// Microbenchmarks of the bulk conversion functions of the input and output
+// character converters. The throughput is in bytes of UTF8.
+namespace {
+	String sourceText() {
+		std::string text;
+		while (text.size() < 64 * 1024) {
+			text += "int caf\xc3\xa9" "Count = 0x1f; // \xe2\x82\xac price in \xce\xb1\xce\xb2\xce\xb3\r\n";
+			text += "\tfor (int i = 0; i < 10; i++) { total += values[i] * 3; }\r\n";
+		}
+		return String(std::move(text));
+	}
+
+	// Convert the text from the encoding in each iteration.
+	void benchmarkInput(BenchState& state, CharEncoding encoding) {
+		String text = sourceText();
+		CHECK(!text.findFirst(String("caf") + Char::fromUtf32(0xe9) + "Count").atEnd());
+		std::string src = CharOutputConverter::create(encoding)->convertString(text);
+		CharInputConverterPtr converter = CharInputConverter::create(
+			encoding, CharInputConverterErrorHandlerPtr(), Char::eof());
+		while (state.keepRunning()) {
+			String dst;
+			converter->convertAppend(src, dst);
+			doNotOptimize(dst);
+		}
+		CHECK(converter->convertString(src) == text);
+		state.setBytesPerIteration(text.toUtf8().size());
+	}
+
+	// Convert the text to the encoding in each iteration.
+	void benchmarkOutput(BenchState& state, CharEncoding encoding) {
+		String text = sourceText();
+		CharOutputConverterPtr converter = CharOutputConverter::create(encoding);
+		while (state.keepRunning()) {
+			std::string dst;
+			converter->convertAppend(text, dst);
+			doNotOptimize(dst);
+		}
+		state.setBytesPerIteration(text.toUtf8().size());
+	}
+}
+
+AUTO_BENCHMARK {
+	benchmarkInput(state, CharEncoding::UTF8);
+}
+
+AUTO_BENCHMARK {
+	benchmarkInput(state, CharEncoding::UTF16LE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkInput(state, CharEncoding::UTF16BE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkInput(state, CharEncoding::UTF32LE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkOutput(state, CharEncoding::UTF8);
+}
+
+AUTO_BENCHMARK {
+	benchmarkOutput(state, CharEncoding::UTF16LE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkOutput(state, CharEncoding::UTF32LE);
+}
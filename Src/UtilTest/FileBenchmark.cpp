@@ -0,0 +1,154 @@
+#include <vector>
+#include "TestTool/TestBenchmark.hpp"
+#include "TestTool/TestFile.hpp"
+#include "TestTool/TestUtil.hpp"
+#include "Util/CharEncoding.hpp"
+#include "Util/File.hpp"
+#include "Util/String.hpp"
+
+// Microbenchmarks of FileEncodedInput throughput against the input buffer size
+// and of writing, reading and finding virtual files. The virtual file system is used so
+// that the disk is not involved apart from the buffer size benchmarks. These
+// read a real file with memory mapping disabled since a virtual file (and a
+// large real file which is memory mapped) is read through a view of the whole
+// file, so the buffer size would only set how much is decoded at a time.
+namespace {
+	// Read the whole of a 4MB file with the given buffer size in each
+	// iteration. The file is several times larger than the largest buffer so
+	// that every buffer size is refilled by reads from the file. It stays in
+	// the operating system's cache between iterations.
+	void benchmarkBufferSize(BenchState& state, Uint bufferSize) {
+		std::string contents;
+		for (int i = 0; contents.size() < 4 * FileEncodedInput::MAX_BUFFER_SIZE; i++) {
+			contents += "A line of text with a little \xe2\x82\xac non-ASCII in it ";
+			contents += (char)('0' + i % 10);
+			contents += "\r\n";
+		}
+		FilePath filePath = TestFile::createBinaryTestFile("UtilTest/benchmark.txt", contents);
+		FileSystem::setMemoryMapping(false);
+
+		// Check that the file is not read through a view
+		{
+			FileBinaryInputPtr in = FileBinaryInput::open(filePath);
+			const char* data;
+			Uint size = 1;
+			CHECK(!in->view(data, size));
+		}
+
+		Uint expectedSize = 0;
+		while (state.keepRunning()) {
+			FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath, bufferSize);
+			String s;
+			Uint size = 0;
+			Uint chunkSize;
+			while ((chunkSize = in->readChunk(s)) != 0) {
+				size += chunkSize;
+				s.clear();
+			}
+			if (expectedSize == 0) {
+				expectedSize = size;
+			}
+			CHECK(size == expectedSize);
+		}
+		state.setBytesPerIteration(contents.size());
+
+		FileSystem::setMemoryMapping(true);
+	}
+}
+
+AUTO_BENCHMARK {
+	benchmarkBufferSize(state, 1024);
+}
+
+AUTO_BENCHMARK {
+	benchmarkBufferSize(state, 16 * 1024);
+}
+
+AUTO_BENCHMARK {
+	benchmarkBufferSize(state, FileEncodedInput::DEFAULT_BUFFER_SIZE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkBufferSize(state, FileEncodedInput::MAX_BUFFER_SIZE);
+}
+
+AUTO_BENCHMARK {
+	benchmarkBufferSize(state, FileEncodedInput::ADAPTIVE_BUFFER_SIZE);
+}
+
+// Write a 2MB virtual file in 1KB pieces and read it back.
+AUTO_BENCHMARK {
+	FileSystem::startVirtualFileSystem();
+
+	std::string piece(1024, 'x');
+	const Uint pieceCount = 2 * 1024;
+	FilePath filePath = TestFile::getTestFile("UtilTest/$benchmark.bin");
+	while (state.keepRunning()) {
+		FileBinaryOutputPtr out = FileBinaryOutput::create(filePath);
+		for (Uint i = 0; i < pieceCount; i++) {
+			out->write(piece);
+		}
+		out->close();
+		std::string contents = FileBinaryInput::open(filePath)->readString();
+		CHECK(contents.size() == pieceCount * piece.size());
+	}
+	state.setBytesPerIteration(pieceCount * piece.size());
+
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Look up files which exist and files which do not among 10000 virtual files.
+AUTO_BENCHMARK {
+	FileSystem::startVirtualFileSystem();
+
+	const Uint fileCount = 10000;
+	std::vector<FilePath> paths;
+	for (Uint i = 0; i < 2 * fileCount; i++) {
+		String name = String("UtilTest/lookup/$") + String(std::to_string(i)) + ".txt";
+		paths.push_back(TestFile::getTestFile(name));
+		if (i < fileCount) {
+			TestFile::createBinaryTestFile(paths.back(), "x");
+		}
+	}
+	while (state.keepRunning()) {
+		Uint found = 0;
+		for (const FilePath& filePath : paths) {
+			found += filePath.exists() ? 1 : 0;
+		}
+		CHECK(found == fileCount);
+	}
+
+	FileSystem::stopVirtualFileSystem();
+}
+
+namespace {
+	// Write a 2MB string of lines to a virtual file with the given encoding
+	// in each iteration.
+	void benchmarkEncodedOutput(BenchState& state, CharEncoding::Ordinal encoding) {
+		FileSystem::startVirtualFileSystem();
+
+		String line = String("A line of text with a little ") + Char::fromUtf32(0x20ac) + " non-ASCII in it\n";
+		String contents;
+		while (contents.toUtf8().size() < 2 * 1024 * 1024) {
+			contents += line;
+		}
+		FilePath filePath = TestFile::getTestFile("UtilTest/$benchmark.txt");
+		while (state.keepRunning()) {
+			FileEncodedOutputPtr out = FileEncodedOutput::create(encoding, filePath);
+			out->write(contents);
+			out->close();
+			CHECK(!out->hasReportedErrors());
+		}
+		state.setBytesPerIteration(contents.toUtf8().size());
+
+		FileSystem::stopVirtualFileSystem();
+	}
+}
+
+AUTO_BENCHMARK {
+	benchmarkEncodedOutput(state, CharEncoding::UTF8);
+}
+
+AUTO_BENCHMARK {
+	benchmarkEncodedOutput(state, CharEncoding::UTF16LE);
+}
@@ -1,9 +1,11 @@
 #include "TestTool/TestFile.hpp"
+#include "TestTool/TestFileSystemErrorHandler.hpp"
 #include "TestTool/TestUtil.hpp"
 #include "Util/Char.hpp"
 #include "Util/CharEncoding.hpp"
 #include "Util/SystemCout.hpp"
 #include "Util/String.hpp"
+#include "Util/WorkStealingPool.hpp"
 
 // Test basic operations of the file system
 AUTO_TEST_CASE {
@@ -231,3 +233,401 @@ AUTO_TEST_CASE {
 
 	FileSystem::stopVirtualFileSystem();
 }
+
+// Test that UTF8 output expands newlines for the platform
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	FilePath filePath = TestFile::getTestFile("UtilTest/$newlines.txt");
+	{
+		FileEncodedOutputPtr out = FileEncodedOutput::create(CharEncoding::UTF8, filePath);
+		*out << "one\ntwo" << 3 << "\n\n" << String("\xe2\x82\xac\n") << Char('\n');
+		out->close();
+		CHECK(!out->hasReportedErrors());
+	}
+#if BUILD(WINDOWS)
+	CHECK(FileBinaryInput::open(filePath)->readString() == "one\r\ntwo3\r\n\r\n\xe2\x82\xac\r\n\r\n");
+#else
+	CHECK(FileBinaryInput::open(filePath)->readString() == "one\ntwo3\n\n\xe2\x82\xac\n\n");
+#endif
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test encoded output through the smallest buffer so that it is written out
+// many times and long lines bypass it
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	String euro = Char::fromUtf32(0x20ac);
+	String longLine(std::string(100, 'x'));
+	String expected;
+	for (int i = 0; i < 20; i++) {
+		expected << i << euro << "\n" << longLine << '\n';
+	}
+
+	const CharEncoding::Ordinal encodings[] = { CharEncoding::UTF8, CharEncoding::UTF16LE, CharEncoding::UTF32BE };
+	for (CharEncoding::Ordinal encoding : encodings) {
+		FilePath filePath = TestFile::getTestFile("UtilTest/$buffered.txt");
+		FileEncodedOutputPtr out = FileEncodedOutput::create(encoding, filePath, FileEncodedOutput::MIN_BUFFER_SIZE);
+		for (int i = 0; i < 20; i++) {
+			*out << i << euro << sendl << longLine << Char('\n');
+		}
+		out->close();
+		CHECK(!out->hasReportedErrors());
+
+		FileEncodedInputPtr in = FileEncodedInput::open(encoding, filePath);
+		CHECK(in->readString() == expected);
+
+		// The same text written as one string is encoded in bulk
+		out = FileEncodedOutput::create(encoding, filePath, FileEncodedOutput::MIN_BUFFER_SIZE);
+		out->write(expected);
+		out->close();
+		CHECK(!out->hasReportedErrors());
+		in = FileEncodedInput::open(encoding, filePath);
+		CHECK(in->readString() == expected);
+	}
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test line and chunk reads
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+
+	// Enough lines with mixed line endings that some newlines straddle the
+	// internal buffer boundaries.
+	const char* endings[] = { "\r\n", "\n", "\r", "\n\r" };
+	std::string contents;
+	std::vector<String> lines;
+	for (int i = 0; i < 300; i++) {
+		std::string line(i * 7 % 50, (char)('a' + i % 26));
+		if (i % 5 == 0) {
+			line += "\xe2\x82\xac";
+		}
+		contents += line + endings[i % 4];
+		lines.push_back(String(line) + "\n");
+	}
+	contents += "last";
+	lines.push_back("last");
+	FilePath filePath = TestFile::createBinaryTestFile("UtilTest/lines.txt", contents);
+
+	String all;
+	{
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath);
+		String line;
+		for (Uint i = 0; i < lines.size(); i++) {
+			line.clear();
+			CHECK(in->readLine(line));
+			CHECK(line == lines[i]);
+			CHECK(in->getLine() == (Line)i + 1);
+			all += line;
+		}
+		CHECK(!in->readLine(line));
+		CHECK(in->getLine() == (Line)lines.size());
+	}
+
+	{
+		// Small chunks never split a character whatever the buffer size
+		const Uint bufferSizes[] = { 16, 100, FileEncodedInput::ADAPTIVE_BUFFER_SIZE, FileEncodedInput::DEFAULT_BUFFER_SIZE };
+		for (Uint bufferSize : bufferSizes) {
+			FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath, bufferSize);
+			String s;
+			Uint size;
+			while ((size = in->readChunk(s, 7u)) != 0) {
+				CHECK(size <= 7u);
+			}
+			CHECK(s == all);
+			CHECK(in->getLine() == (Line)lines.size());
+		}
+
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath);
+		String s;
+		while (in->readChunk(s) != 0) {
+		}
+		CHECK(s == all);
+	}
+
+	{
+		// A chunk smaller than the next character still returns the character
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath);
+		String s;
+		CHECK(in->readChunk(s, 1u) == 3u);
+		CHECK(s == "\xe2\x82\xac");
+		CHECK(in->read() == Char('\n'));
+		CHECK(in->getLine() == 1);
+		CHECK(in->readChunk(s, 1u) == 1u);
+		CHECK(in->getLine() == 2);
+	}
+
+	{
+		// Mixing character, line and chunk reads
+		FilePath mixed = TestFile::createBinaryTestFile("UtilTest/mixed.txt", "ab\r\ncd\n\ref\rgh");
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, mixed);
+		CHECK(in->read() == Char('a'));
+		String s;
+		CHECK(in->readLine(s));
+		CHECK(s == "b\n");
+		CHECK(in->getLine() == 1);
+		CHECK(in->read() == Char('c'));
+		CHECK(in->getLine() == 2);
+		s.clear();
+		CHECK(in->readChunk(s, 4u) == 4u);
+		CHECK(s == "d\nef");
+		CHECK(in->getLine() == 3);
+		CHECK(in->readString() == "\ngh");
+		CHECK(in->getLine() == 4);
+	}
+
+	{
+		// Errors are reported with the line of the bad character
+		std::string bad(3000, 'x');
+		bad += "\r\n\n\r\r\n\r\xff\n";
+		FilePath badPath = TestFile::createBinaryTestFile("UtilTest/bad.txt", bad);
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, badPath);
+		TestUtil::expectEvent(CannotEncodeForInputTestEvent::create(5, "0xff"));
+		String s;
+		while (in->readChunk(s) != 0) {
+		}
+		CHECK(s == String(std::string(3000, 'x')) + "\n\n\n\n \n");
+		CHECK(in->getLine() == 6);
+	}
+
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test large platform files which are read through a view of the whole file
+AUTO_TEST_CASE {
+	std::string contents;
+	for (int i = 0; contents.size() < 200000; i++) {
+		contents += "Line ";
+		contents += (char)('0' + i % 10);
+		contents += "\xc2\xa2\r\n";
+	}
+	FilePath filePath = TestFile::createBinaryTestFile("UtilTest/large.txt", contents);
+
+	{
+		FileBinaryInputPtr in = FileBinaryInput::open(filePath);
+		CHECK(in->readString(5) == "Line ");
+		const char* data;
+		Uint size = 3;
+		CHECK(in->view(data, size));
+		CHECK(size == 3);
+		CHECK(std::string(data, size) == "0\xc2\xa2");
+		CHECK(in->readString() == contents.substr(8));
+		size = 3;
+		CHECK(in->view(data, size));
+		CHECK(size == 0);
+	}
+
+	{
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath);
+		String s;
+		while (in->readChunk(s) != 0) {
+		}
+		std::string expected;
+		for (Uint i = 0; i < contents.size(); i++) {
+			if (contents[i] != '\r') {
+				expected += contents[i];
+			}
+		}
+		CHECK(s == String(expected));
+		CHECK(in->getLine() == (Line)(contents.size() / 10) + 1);
+	}
+
+	{
+		// Small files are not held in memory
+		FilePath smallPath = TestFile::createBinaryTestFile("UtilTest/small.txt", "small");
+		FileBinaryInputPtr in = FileBinaryInput::open(smallPath);
+		const char* data;
+		Uint size = 3;
+		CHECK(!in->view(data, size));
+		CHECK(in->readString() == "small");
+	}
+
+	{
+		// Large files are read through the buffer without memory mapping
+		FileSystem::setMemoryMapping(false);
+		FileBinaryInputPtr in = FileBinaryInput::open(filePath);
+		FileSystem::setMemoryMapping(true);
+		const char* data;
+		Uint size = 3;
+		CHECK(!in->view(data, size));
+		CHECK(in->readString() == contents);
+	}
+
+	// Seek and positioned reads of both large and small files
+	FilePath smallPath = TestFile::getTestFile("UtilTest/small.txt");
+	for (const FilePath& path : { filePath, smallPath }) {
+		FileBinaryInputPtr in = FileBinaryInput::open(path);
+		char buf[8];
+		CHECK(in->readAt(buf, 1, 3) == 3);
+		CHECK(std::string(buf, 3) == ((path == filePath) ? "ine" : "mal"));
+		CHECK(in->readString(2) == ((path == filePath) ? "Li" : "sm"));
+		CHECK(in->seek(4));
+		CHECK(in->readString(1) == ((path == filePath) ? " " : "l"));
+		CHECK(in->readAt(buf, 10000000, 3) == 0);
+		CHECK(!in->seek(10000000));
+		CHECK(in->readString(1) == ((path == filePath) ? "0" : ""));
+	}
+}
+
+// Test virtual files which are held in memory and so can be viewed
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+
+	FilePath filePath = TestFile::getTestFile("UtilTest/$large.txt");
+	std::string contents;
+	{
+		FileBinaryOutputPtr out = FileBinaryOutput::create(filePath);
+		for (int i = 0; contents.size() < 100000; i++) {
+			std::string line = "Line ";
+			line += (char)('0' + i % 10);
+			line += "\r\n";
+			out->write(line);
+			contents += line;
+		}
+		out->close();
+	}
+
+	{
+		FileBinaryInputPtr in = FileBinaryInput::open(filePath);
+		CHECK(in->readString(5) == "Line ");
+		const char* data;
+		Uint size = 3;
+		CHECK(in->view(data, size));
+		CHECK(size == 3);
+		CHECK(std::string(data, size) == "0\r\n");
+
+		// The view stays valid after the file is replaced
+		TestFile::createBinaryTestFile(filePath, "replaced");
+		CHECK(std::string(data, size) == "0\r\n");
+		CHECK(in->readString() == contents.substr(8));
+		size = 3;
+		CHECK(in->view(data, size));
+		CHECK(size == 0);
+
+		char buf[8];
+		CHECK(in->readAt(buf, 2, 3) == 3);
+		CHECK(std::string(buf, 3) == "ne ");
+		CHECK(in->seek(5));
+		CHECK(in->readString(1) == "0");
+		CHECK(!in->seek((Uint)contents.size() + 1));
+		CHECK(in->seek((Uint)contents.size()));
+		CHECK(in->readString() == "");
+	}
+
+	{
+		FileEncodedInputPtr in = FileEncodedInput::open(CharEncoding::UTF8, filePath);
+		String s;
+		while (in->readChunk(s) != 0) {
+		}
+		CHECK(s == "replaced");
+	}
+
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test many virtual files so that the hash tables grow
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	const Uint fileCount = 3000;
+	for (Uint i = 0; i < fileCount; i++) {
+		String name = String("UtilTest/many/$") + String(std::to_string(i)) + ".txt";
+		TestFile::createBinaryTestFile(name, std::to_string(i));
+	}
+	bool allFound = true;
+	for (Uint i = 0; i < fileCount; i++) {
+		String name = String("UtilTest/many/$") + String(std::to_string(i)) + ".txt";
+		FilePath filePath = TestFile::getTestFile(name);
+		allFound = allFound && filePath.exists() && (FileBinaryInput::open(filePath)->readString() == std::to_string(i));
+	}
+	CHECK(allFound);
+	CHECK(!TestFile::getTestFile("UtilTest/many/$3000.txt").exists());
+
+	// Overwrite a file
+	FilePath filePath = TestFile::createBinaryTestFile("UtilTest/many/$7.txt", "seven");
+	CHECK(FileBinaryInput::open(filePath)->readString() == "seven");
+
+	// Restarting removes all the files but the paths can be used again
+	FileSystem::startVirtualFileSystem();
+	CHECK(!filePath.exists());
+	TestFile::createBinaryTestFile(filePath, "7");
+	CHECK(FileBinaryInput::open(filePath)->readString() == "7");
+	CHECK(!TestFile::getTestFile("UtilTest/many/$8.txt").exists());
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test virtual file system namespaces
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	FilePath filePath = TestFile::createBinaryTestFile("UtilTest/$namespace.txt", "original");
+
+	// A new namespace starts disabled and then has its own files
+	Uint originalNamespace = FileSystem::getVirtualNamespace();
+	FileSystem::setVirtualNamespace(1000000);
+	CHECK(!filePath.isVirtual());
+	FileSystem::startVirtualFileSystem();
+	CHECK(filePath.isVirtual());
+	CHECK(!filePath.exists());
+	TestFile::createBinaryTestFile(filePath, "one thousand");
+	CHECK(FileBinaryInput::open(filePath)->readString() == "one thousand");
+
+	// Stopping it does not affect the original namespace
+	FileSystem::stopVirtualFileSystem();
+	FileSystem::setVirtualNamespace(originalNamespace);
+	CHECK(FileBinaryInput::open(filePath)->readString() == "original");
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test concurrent use of the virtual file system both in separate namespaces
+// and by several threads in the same one
+AUTO_TEST_CASE {
+	FileSystem::startVirtualFileSystem();
+	Uint sharedNamespace = FileSystem::getVirtualNamespace();
+	const Uint taskCount = 64;
+	std::vector<int> errors(taskCount, 0);
+	WorkStealingPool::run(taskCount, 4, [&](Uint index, Uint) {
+		std::string expected(5000, (char)('a' + index % 26));
+		for (int i = 0; i < 20; i++) {
+			// The same name in every namespace
+			FileSystem::setVirtualNamespace(2000000 + index);
+			FileSystem::startVirtualFileSystem();
+			FilePath own = TestFile::createBinaryTestFile("UtilTest/$own.txt", expected);
+			errors[index] += (FileBinaryInput::open(own)->readString() != expected) ? 1 : 0;
+			FileSystem::stopVirtualFileSystem();
+
+			// A name shared by several tasks in the namespace of the test
+			FileSystem::setVirtualNamespace(sharedNamespace);
+			String name = String("UtilTest/$shared") + String(std::to_string(index % 8)) + ".txt";
+			FilePath shared = TestFile::createBinaryTestFile(name, expected);
+			std::string contents = FileBinaryInput::open(shared)->readString();
+			// Another task may have created the file but not yet written to it
+			// (as with a platform file) so it may be empty. Otherwise whichever
+			// task wrote last the contents must not be torn.
+			errors[index] += (!contents.empty() && contents != std::string(expected.size(), contents[0])) ? 1 : 0;
+		}
+	});
+	FileSystem::setVirtualNamespace(sharedNamespace);
+	for (Uint i = 0; i < taskCount; i++) {
+		CHECK(errors[i] == 0);
+	}
+	FileSystem::stopVirtualFileSystem();
+}
+
+// Test file status
+AUTO_TEST_CASE {
+	Uint64 size;
+	Int64 modifiedTime;
+	FilePath filePath = TestFile::createBinaryTestFile("UtilTest/status.txt", "12345");
+	CHECK(filePath.getStatus(size, modifiedTime));
+	CHECK(size == 5);
+	CHECK(!TestFile::getTestFile("UtilTest/nostatus.txt").getStatus(size, modifiedTime));
+
+	FileSystem::startVirtualFileSystem();
+	FilePath virtualPath = TestFile::createBinaryTestFile("UtilTest/$status.txt", "123");
+	CHECK(virtualPath.getStatus(size, modifiedTime));
+	CHECK(size == 3);
+	Int64 firstTime = modifiedTime;
+	TestFile::createBinaryTestFile(virtualPath, "1234");
+	CHECK(virtualPath.getStatus(size, modifiedTime));
+	CHECK(size == 4);
+	CHECK(modifiedTime > firstTime);
+	FileSystem::stopVirtualFileSystem();
+}
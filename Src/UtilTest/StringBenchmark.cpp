@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "TestTool/TestBenchmark.hpp"
+#include "TestTool/TestUtil.hpp"
+#include "Util/String.hpp"
+
+namespace {
+	// Path fragments which are long enough not to fit in the small string
+	// buffer of std::string so that every copy allocates.
+	const char* const PATH_PREFIX = "c:\\users\\somebody\\documents\\projects\\cppdevtools";
+	const char* const PATH_SUFFIX = "utiltest\\stringbenchmark_with_a_long_name.cpp";
+
+	// The file name processing done by TestCase::TestCase().
+	String testFilename(const String& file) {
+		String fullFile = file.toLowerCopy();
+		String separator = "\\";
+		String sourcePathFragment = separator + "src" + separator;
+		StringIterPair pos = fullFile.findFirst(sourcePathFragment);
+		String ret = "src/";
+		for (StringIter it = pos.second(); !it.atEnd(); it++) {
+			ret += (*it == '\\') ? Char('/') : *it;
+		}
+		return ret;
+	}
+
+	// The character at a time implementations of String::toLowerCopy() and
+	// String::caselessEquals() for comparison.
+	String referenceLowerCopy(const String& s) {
+		String ret;
+		for (StringIter it = s.begin(); !it.atEnd(); ++it) {
+			ret += it->toLowerCopy();
+		}
+		return ret;
+	}
+
+	bool referenceCaselessEquals(const String& s1, const String& s2) {
+		StringIter it1 = s1.begin();
+		StringIter it2 = s2.begin();
+		for (; !it1.atEnd() && !it2.atEnd(); ++it1, ++it2) {
+			if ((*it1 != *it2) && (it1->toUpperCopy() != it2->toUpperCopy())) {
+				return false;
+			}
+		}
+		return it1.atEnd() && it2.atEnd();
+	}
+
+	// A file path with non-ASCII characters.
+	String nonAsciiPath() {
+		return String("C:\\Users\\J") + Char::fromUtf32(0xf6) + "rg\\CppDevTools\\Src\\TestTool\\Impl\\TestManager.cpp";
+	}
+
+	// The number of times a Result has been copied. The file names are too
+	// long for the small string buffer so each copy is an allocation.
+	Uint64 resultCopyCount = 0;
+
+	// A record as sorted by AssertHashMap.
+	struct Result {
+		Result(Uint32 hash_, String file_) : hash(hash_), file(std::move(file_)) { }
+		Result(const Result& other) : hash(other.hash), file(other.file) { ++resultCopyCount; }
+		Result(Result&&) = default;
+		Result& operator=(const Result& other) {
+			hash = other.hash;
+			file = other.file;
+			++resultCopyCount;
+			return *this;
+		}
+		Result& operator=(Result&&) = default;
+		bool operator<(const Result& other) const {
+			return (hash < other.hash) || ((hash == other.hash) && (file < other.file));
+		}
+		Uint32 hash;
+		String file;
+	};
+
+	// A Result which is copied wherever it would be moved, as a String was
+	// before it had move operations.
+	struct CopiedResult {
+		CopiedResult(Uint32 hash_, String file_) : result(hash_, std::move(file_)) { }
+		CopiedResult(const CopiedResult& other) : result(other.result) { }
+		CopiedResult& operator=(const CopiedResult& other) {
+			result = other.result;
+			return *this;
+		}
+		bool operator<(const CopiedResult& other) const {
+			return result < other.result;
+		}
+		Result result;
+	};
+
+	// Build and sort the results as AssertHashMap does, returning the
+	// number of allocations made by copying them in the last iteration.
+	template<class R> Uint64 benchmarkSortResults(BenchState& state) {
+		String file = String(PATH_PREFIX) + PATH_SUFFIX;
+		Uint64 copies = 0;
+		while (state.keepRunning()) {
+			resultCopyCount = 0;
+			std::vector<R> results;
+			results.reserve(1000);
+			for (Uint32 i = 0; i < 1000; i++) {
+				results.push_back(R((i * 2654435761u) >> 8, file));
+			}
+			std::sort(results.begin(), results.end());
+			doNotOptimize(results);
+			copies = resultCopyCount;
+		}
+		return copies;
+	}
+}
+
+// The TestCase file name processing.
+AUTO_BENCHMARK {
+	String file = String(PATH_PREFIX) + "\\Src\\" + PATH_SUFFIX;
+	while (state.keepRunning()) {
+		doNotOptimize(testFilename(file));
+	}
+	CHECK(testFilename(file) == "src/utiltest/stringbenchmark_with_a_long_name.cpp");
+}
+
+// The AssertHashMap prefix stripping.
+AUTO_BENCHMARK {
+	String file = String(PATH_PREFIX) + "\\Src\\" + PATH_SUFFIX;
+	String basePrefix = String(PATH_PREFIX) + "\\Src\\";
+	while (state.keepRunning()) {
+		StringIterPair pr = file.findFirst(basePrefix);
+		doNotOptimize(Result(0, pr.second().substrAfter()));
+	}
+}
+
+// Sorting the AssertHashMap results with and without String move
+// operations. With them the results are never copied. Without them each
+// result is copied into the vector and again by every swap of the sort.
+AUTO_BENCHMARK {
+	CHECK(benchmarkSortResults<Result>(state) == 0);
+}
+
+AUTO_BENCHMARK {
+	CHECK(benchmarkSortResults<CopiedResult>(state) > 1000);
+}
+
+// Case conversion and caseless comparison of file paths as done by TestCase
+// (which lowercases every __FILE__) and TestManager (which compares every
+// test file name against each command line filter). The bulk ASCII
+// implementations are compared with the character at a time ones.
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	while (state.keepRunning()) {
+		doNotOptimize(referenceLowerCopy(path));
+	}
+	CHECK(referenceLowerCopy(path) == path.toLowerCopy());
+	state.setBytesPerIteration(path.toUtf8().size());
+}
+
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	while (state.keepRunning()) {
+		doNotOptimize(path.toLowerCopy());
+	}
+	state.setBytesPerIteration(path.toUtf8().size());
+}
+
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	String filter = path.toUpperCopy();
+	while (state.keepRunning()) {
+		doNotOptimize(referenceCaselessEquals(path, filter));
+	}
+	CHECK(referenceCaselessEquals(path, filter) && path.caselessEquals(filter));
+	state.setBytesPerIteration(path.toUtf8().size());
+}
+
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	String filter = path.toUpperCopy();
+	while (state.keepRunning()) {
+		doNotOptimize(path.caselessEquals(filter));
+	}
+	state.setBytesPerIteration(path.toUtf8().size());
+}
+
+// Building a String a character at a time with each character classified
+// and converted as it is appended.
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	std::vector<Char> chars;
+	for (Uint i = 0; i < 64; i++) {
+		for (StringIter it = path.begin(); !it.atEnd(); ++it) {
+			chars.push_back(*it);
+		}
+	}
+	while (state.keepRunning()) {
+		String s;
+		for (Char ch : chars) {
+			s += ch.isPpIdentifier() ? ch.toLowerCopy() : Char('_');
+		}
+		doNotOptimize(s);
+	}
+	state.setBytesPerIteration(chars.size());
+}
+
+// Conversion of a file path to and from a platform string as done for every
+// file opened and every directory listed.
+AUTO_BENCHMARK {
+	String path = nonAsciiPath();
+	while (state.keepRunning()) {
+		doNotOptimize(path.toPlatform());
+	}
+	state.setBytesPerIteration(path.toUtf8().size());
+}
+
+AUTO_BENCHMARK {
+	PlatformString path = nonAsciiPath().toPlatform();
+	while (state.keepRunning()) {
+		doNotOptimize(String::fromPlatform(path));
+	}
+	state.setBytesPerIteration(path.size());
+}
+
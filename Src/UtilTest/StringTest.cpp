@@ -1,4 +1,15 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Util/CharOutputConverter.hpp"
+#include "Util/OutputStreamWithIndent.hpp"
 #include "Util/String.hpp"
+#include "Util/WorkStealingPool.hpp"
 #include "TestTool/TestUtil.hpp"
 
 AUTO_TEST_CASE {
@@ -144,3 +155,256 @@ AUTO_TEST_CASE {
 	CHECK(!String("AaZz09_%").caselessBeginsWith("AaZz09_% "));
 	CHECK(String("AaZz09_%").caselessBeginsWith(""));
 }
+
+AUTO_TEST_CASE {
+	// Move construction and assignment leave the source empty
+	String a = "a string which is too long for the small string buffer";
+	String b(std::move(a));
+	CHECK(a.empty());
+	CHECK(b == "a string which is too long for the small string buffer");
+	a = std::move(b);
+	CHECK(b.empty());
+	CHECK(a == "a string which is too long for the small string buffer");
+	b = "x";
+	a = b;
+	CHECK(a == "x");
+	CHECK(b == "x");
+
+	// Concatenation with temporaries on either side
+	String x = "x";
+	String y = "y";
+	CHECK(x + y == "xy");
+	CHECK(String("w") + y == "wy");
+	CHECK(x + String("z") == "xz");
+	CHECK(String("w") + String("z") == "wz");
+	CHECK(String("w") + Char('z') == "wz");
+	CHECK(x + "1" + y + Char('2') + "3" == "x1y23");
+	CHECK(x == "x");
+	CHECK(y == "y");
+
+	CHECK(String("utf8").toUtf8() == "utf8");
+	CHECK(x.toUtf8() == "x");
+	CHECK(x == "x");
+}
+
+AUTO_TEST_CASE {
+	// Character index of an ASCII string
+	String ascii = "hello";
+	CHECK(ascii.size() == 5);
+	CHECK(ascii.at(0) == Char('h'));
+	CHECK(ascii.at(4) == Char('o'));
+	CHECK(*ascii.iterAt(1) == Char('e'));
+	CHECK(ascii.iterAt(5) == ascii.end());
+	String empty;
+	CHECK(empty.size() == 0);
+	CHECK(empty.iterAt(0) == empty.end());
+
+	// Mixed 1, 2, 3 and 4 byte characters over several index intervals
+	String mixed;
+	std::vector<Char> chars;
+	const Char samples[] = { Char('a'), Char::fromUtf32(0xe9), Char::fromUtf32(0x20ac), Char::fromUtf32(0x1f600) };
+	for (int i = 0; i < 200; i++) {
+		Char ch = samples[(i * 7) % 4];
+		mixed += ch;
+		chars.push_back(ch);
+	}
+	REQUIRE(mixed.size() == 200);
+	for (Uint i = 0; i < 200; i++) {
+		CHECK(mixed.at(i) == chars[i]);
+		CHECK(*mixed.iterAt(i) == chars[i]);
+	}
+	CHECK(mixed.iterAt(200) == mixed.end());
+	CHECK(String(mixed.iterAt(198), mixed.end()) == String(chars[198]) + chars[199]);
+
+	// Modification discards the index
+	mixed += Char::fromUtf32(0x20ac);
+	CHECK(mixed.size() == 201);
+	CHECK(mixed.at(200) == Char::fromUtf32(0x20ac));
+	mixed += String("xy");
+	CHECK(mixed.size() == 203);
+	CHECK(mixed.at(202) == Char('y'));
+	mixed << Char('z');
+	CHECK(mixed.size() == 204);
+	String copy = mixed;
+	CHECK(copy.size() == 204);
+	mixed = "ab";
+	CHECK(mixed.size() == 2);
+	copy = std::move(mixed);
+	CHECK(copy.size() == 2);
+	CHECK(mixed.size() == 0);
+	copy.clear();
+	CHECK(copy.size() == 0);
+
+	// Prepending to an indexed rvalue discards its index
+	String prefix = String(Char::fromUtf32(0xe9)) + "a";
+	String indexed = String(Char::fromUtf32(0x1f600)) + "bc";
+	CHECK(indexed.size() == 3);
+	String joined = prefix + std::move(indexed);
+	CHECK(joined.size() == 5);
+	CHECK(joined.at(0) == Char::fromUtf32(0xe9));
+	CHECK(joined.at(2) == Char::fromUtf32(0x1f600));
+	CHECK(joined.at(4) == Char('c'));
+	CHECK(*joined.iterAt(3) == Char('b'));
+	CHECK(joined.iterAt(5) == joined.end());
+}
+
+// Threads sharing a String can all build its character index
+AUTO_TEST_CASE {
+	String shared;
+	for (int i = 0; i < 100; i++) {
+		shared += Char::fromUtf32(0xe9);
+		shared += Char('a');
+	}
+	// Each thread runs one task and they all wait to use the string at once
+	const Uint taskCount = 4;
+	std::vector<int> errors(taskCount, 0);
+	std::atomic<Uint> waiting(0);
+	WorkStealingPool::run(taskCount, taskCount, [&](Uint index, Uint) {
+		waiting.fetch_add(1, std::memory_order_relaxed);
+		while (waiting.load(std::memory_order_relaxed) < taskCount) {
+			std::this_thread::yield();
+		}
+		Uint pos = index * 10 + 1;
+		errors[index] += (shared.size() == 200) ? 0 : 1;
+		errors[index] += (shared.at(pos) == Char('a')) ? 0 : 1;
+		errors[index] += (*shared.iterAt(pos - 1) == Char::fromUtf32(0xe9)) ? 0 : 1;
+	});
+	for (Uint i = 0; i < taskCount; i++) {
+		CHECK(errors[i] == 0);
+	}
+}
+
+AUTO_TEST_CASE {
+	// Streaming strings in bulk and a character at a time
+	String euro = Char::fromUtf32(0x20ac);
+	String s;
+	s << "abc" << euro << String("def\nghi") << 'j' << 42 << sendl << sflush;
+	CHECK(s == String("abc") + euro + "def\nghij42\n");
+
+	// Integers are formatted directly
+	String numbers;
+	numbers << 0 << ' ' << -7 << ' ' << std::numeric_limits<int>::min() << ' ' << std::numeric_limits<long long>::min()
+		<< ' ' << std::numeric_limits<unsigned long long>::max() << ' ' << 1234567890u;
+	CHECK(numbers == "0 -7 -2147483648 -9223372036854775808 18446744073709551615 1234567890");
+
+	// An indenting stream indents the lines of a string which are not empty
+	String indented;
+	OutputStreamWithIndent os(indented);
+	os << "a\nb" << sindent << String("\nc\n\nd") << sundent << sflush;
+	os << '\n' << sindent << 1 << sendl << sundent << "e\n";
+	CHECK(indented == "a\nb\n\tc\n\n\td\n\t1\ne\n");
+}
+
+AUTO_TEST_CASE {
+	// Case conversion and comparison of long strings with non-ASCII characters
+	// before, within and after runs of ASCII
+	String euro = Char::fromUtf32(0x20ac);
+	String lower = String("c:\\users\\somebody\\projects\\") + euro + "cppdevtools\\src\\utiltest\\stringtest.cpp" + euro;
+	String upper = String("C:\\USERS\\SOMEBODY\\PROJECTS\\") + euro + "CPPDEVTOOLS\\SRC\\UTILTEST\\STRINGTEST.CPP" + euro;
+	String mixed = String("C:\\Users\\Somebody\\Projects\\") + euro + "CppDevTools\\Src\\UtilTest\\StringTest.cpp" + euro;
+	CHECK(mixed.toUpperCopy() == upper);
+	CHECK(mixed.toLowerCopy() == lower);
+	CHECK((euro + mixed).toLowerCopy() == euro + lower);
+	CHECK(mixed.caselessEquals(upper));
+	CHECK(lower.caselessEquals(mixed));
+	CHECK((euro + lower).caselessEquals(euro + upper));
+	CHECK(!(euro + lower).caselessEquals(String("xyz") + upper));
+	CHECK(!lower.caselessEquals(upper + "x"));
+	CHECK(!(lower + "[").caselessEquals(upper + "{"));
+	CHECK(!(lower + "@").caselessEquals(upper + "`"));
+	CHECK(mixed.caselessBeginsWith(upper));
+	CHECK(mixed.caselessBeginsWith(String("c:\\USERS\\somebody\\PROJECTS\\") + euro + "Cpp"));
+	CHECK(!mixed.caselessBeginsWith("c:\\USERS\\somebody\\PROJECTS\\Cpp"));
+	CHECK(!mixed.caselessBeginsWith(upper + "x"));
+
+	// Differences at each position of a string longer than the vector width
+	String a = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	String b = a.toUpperCopy();
+	CHECK(b == "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789");
+	CHECK(a.toLowerCopy() == "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0123456789");
+	for (Uint i = 0; i < a.size(); i++) {
+		String c = String(a.begin(), a.iterAt(i)) + "_" + String(a.iterAt(i + 1), a.end());
+		CHECK(!a.caselessEquals(c));
+		CHECK(!c.caselessEquals(b));
+		CHECK(c.caselessBeginsWith(String(b.begin(), b.iterAt(i))));
+	}
+}
+
+// Case conversion and caseless comparison of file paths with long ASCII runs
+// (which are converted in bulk) around a non-ASCII character without case
+AUTO_TEST_CASE {
+	String mixed = String("C:\\Users\\Somebody\\Documents\\J") + Char::fromUtf32(0x20ac) + "rg\\CppDevTools\\Src\\Util\\Impl\\String.cpp";
+	String lower = String("c:\\users\\somebody\\documents\\j") + Char::fromUtf32(0x20ac) + "rg\\cppdevtools\\src\\util\\impl\\string.cpp";
+	String upper = String("C:\\USERS\\SOMEBODY\\DOCUMENTS\\J") + Char::fromUtf32(0x20ac) + "RG\\CPPDEVTOOLS\\SRC\\UTIL\\IMPL\\STRING.CPP";
+	CHECK(mixed.toLowerCopy() == lower);
+	CHECK(mixed.toUpperCopy() == upper);
+	CHECK(mixed.caselessEquals(upper));
+	CHECK(lower.caselessEquals(upper));
+	CHECK(!lower.caselessEquals(upper + "X"));
+	CHECK(!lower.caselessEquals(String(upper.begin(), upper.iterAt(upper.size() - 1)) + "Q"));
+}
+
+// Concatenating temporaries reuses their buffers. Moving a String moves its
+// UTF8 buffer so when the buffer of the first temporary has room for the
+// whole result, the result is built in that same buffer without any copies.
+// The strings are too long for the small string buffer of std::string.
+AUTO_TEST_CASE {
+	const char* prefix = "c:\\users\\somebody\\documents\\projects\\cppdevtools";
+	String b = "utiltest\\stringtest_with_a_long_name.cpp";
+	std::string first = prefix;
+	first.reserve(256);
+	const char* buffer = first.data();
+
+	String moved = String(std::move(first)) + "\\src\\" + b + Char('x');
+	CHECK(moved == String(prefix) + "\\src\\" + b + "x");
+	std::string utf8 = std::move(moved).toUtf8();
+	CHECK(utf8.data() == buffer);
+}
+
+// Sorting a vector of strings moves them rather than copying them so each
+// string ends up with a buffer which one of the strings had before sorting.
+AUTO_TEST_CASE {
+	struct Result {
+		Result(Uint32 hash_, String file_) : hash(hash_), file(std::move(file_)) { }
+		bool operator<(const Result& other) const {
+			return (hash < other.hash) || ((hash == other.hash) && (file < other.file));
+		}
+		Uint32 hash;
+		String file;
+	};
+	std::vector<Result> results;
+	for (Uint32 i = 0; i < 1000; i++) {
+		results.push_back(Result((i * 2654435761u) >> 8, "c:\\users\\somebody\\documents\\stringtest_with_a_long_name.cpp"));
+	}
+	std::set<const char*> buffers;
+	for (Result& result : results) {
+		std::string utf8 = std::move(result.file).toUtf8();
+		buffers.insert(utf8.data());
+		result.file = String(std::move(utf8));
+	}
+	std::sort(results.begin(), results.end());
+	CHECK(std::is_sorted(results.begin(), results.end()));
+	for (Result& result : results) {
+		std::string utf8 = std::move(result.file).toUtf8();
+		CHECK(buffers.count(utf8.data()) == 1);
+	}
+}
+
+// Platform strings
+AUTO_TEST_CASE {
+	String ascii = "The quick brown fox jumps over the lazy dog 0123456789.";
+	String s = ascii + Char::fromUtf32(0xe9) + ascii + Char::fromUtf32(0x20ac) + Char::fromUtf32(0x1d11e) + ascii + Char::fromUtf32(0xffff);
+	CHECK(String::fromPlatform(s.toPlatform()) == s);
+	CHECK(String::fromPlatform(String().toPlatform()).empty());
+#if BUILD(MSV)
+	// The same as the UTF16 output converter
+	std::string utf16 = CharOutputConverter::create(CharEncoding::UTF16LE)->convertString(s);
+	PlatformString platform = s.toPlatform();
+	CHECK(platform.size() * 2 == utf16.size());
+	CHECK(memcmp(platform.data(), utf16.data(), utf16.size()) == 0);
+
+	// Unpaired surrogates
+	CHECK(String::fromPlatform(L"a\xd834" L"b\xdd1e") == String("a\xef\xbf\xbd" "b\xef\xbf\xbd"));
+#endif
+}
+
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "TestTool/TestUtil.hpp"
+#include "Util/String.hpp"
+#include "Util/WorkStealingPool.hpp"
+
+// Every task runs exactly once whatever the thread count
+AUTO_TEST_CASE {
+	const Uint threadCounts[] = { 1, 2, 3, 8, 64 };
+	const Uint taskCounts[] = { 0, 1, 5, 1000 };
+	for (Uint threadCount : threadCounts) {
+		for (Uint taskCount : taskCounts) {
+			std::vector<std::atomic<int>> counts(taskCount);
+			for (auto& count : counts) {
+				count = 0;
+			}
+			std::atomic<bool> badThread(false);
+			WorkStealingPool::run(taskCount, threadCount, [&](Uint index, Uint thread) {
+				if (thread >= threadCount) {
+					badThread = true;
+				}
+				// Uneven task sizes so that stealing happens
+				volatile Uint sum = 0;
+				for (Uint i = 0; i < (index % 7) * 1000; i++) {
+					sum = sum + i;
+				}
+				counts[index]++;
+			});
+			CHECK(!badThread);
+			for (auto& count : counts) {
+				CHECK(count == 1);
+			}
+		}
+	}
+}
+
+// One thread runs the tasks in order on the calling thread
+AUTO_TEST_CASE {
+	std::vector<Uint> order;
+	WorkStealingPool::run(5, 1, [&](Uint index, Uint thread) {
+		CHECK(thread == 0);
+		order.push_back(index);
+	});
+	CHECK(order == std::vector<Uint>({ 0, 1, 2, 3, 4 }));
+	CHECK(WorkStealingPool::defaultThreadCount() >= 1);
+}
+
+// An exception in a task is passed back to the caller
+AUTO_TEST_CASE {
+	std::atomic<int> started(0);
+	std::atomic<bool> reached(false);
+	bool caught = false;
+	try {
+		// The tasks after the failing one wait until it has started and then
+		// take long enough that the other threads cannot run all of theirs
+		// before the pool stops
+		WorkStealingPool::run(100000, 4, [&](Uint index, Uint thread) {
+			started++;
+			if (index == 10) {
+				reached = true;
+				throw String("task failed");
+			}
+			if (index > 10) {
+				while (!reached) {
+					std::this_thread::yield();
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+	}
+	catch (String& ex) {
+		caught = (ex == "task failed");
+	}
+	CHECK(caught);
+	CHECK(started < 100000);
+}